@@ -0,0 +1,102 @@
+/*** frame.c -- framed statement streams
+ *
+ * Copyright (C) 2026 Sebastian Freundt
+ *
+ * Author:  Sebastian Freundt <freundt@ga-group.nl>
+ *
+ * This file is part of rdfsnips.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the author nor the names of any contributors
+ *    may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED.  IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ ***/
+#if defined HAVE_CONFIG_H
+# include "config.h"
+#endif	/* HAVE_CONFIG_H */
+#include <stdint.h>
+#include <string.h>
+#include "frame.h"
+#include "nifty.h"
+
+
+int
+frame_magicp(const char *s, size_t z)
+{
+	if (z >= FRAME_MAGIC_LEN) {
+		return !memcmp(s, FRAME_MAGIC, FRAME_MAGIC_LEN);
+	} else if (z && memcmp(s, FRAME_MAGIC, z)) {
+		return 0;
+	}
+	return -1;
+}
+
+size_t
+frame_hdrz(size_t z)
+{
+	size_t n = 1U;
+
+	for (uint64_t v = (uint64_t)z << 1U; v >= 0x80U; v >>= 7U, n++);
+	return n;
+}
+
+size_t
+frame_put(char *restrict buf, size_t z, bool dirp)
+{
+	uint64_t v = (uint64_t)z << 1U | dirp;
+	size_t n = 0U;
+
+	for (; v >= 0x80U; v >>= 7U) {
+		buf[n++] = (char)((v & 0x7fU) | 0x80U);
+	}
+	buf[n++] = (char)v;
+	return n;
+}
+
+const char*
+frame_get(struct frame_s *restrict f, const char *s, const char *e)
+{
+	uint64_t v = 0U;
+
+	for (unsigned int sh = 0U; s < e && sh < 64U; sh += 7U) {
+		const uint8_t c = *s++;
+
+		v |= (uint64_t)(c & 0x7fU) << sh;
+		if (LIKELY(!(c & 0x80U))) {
+			if (UNLIKELY((size_t)(e - s) < (v >> 1U))) {
+				/* statement isn't all there */
+				return NULL;
+			}
+			f->s = s;
+			f->z = v >> 1U;
+			f->dirp = v & 1U;
+			return s + f->z;
+		}
+	}
+	return NULL;
+}
+
+/* frame.c ends here */
@@ -0,0 +1,85 @@
+/*** frame.h -- framed statement streams
+ *
+ * Copyright (C) 2026 Sebastian Freundt
+ *
+ * Author:  Sebastian Freundt <freundt@ga-group.nl>
+ *
+ * This file is part of rdfsnips.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the author nor the names of any contributors
+ *    may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED.  IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ ***/
+#if !defined INCLUDED_frame_h_
+#define INCLUDED_frame_h_
+#include <stddef.h>
+#include <stdbool.h>
+
+/* Framed statement streams, as written with --emit-framed and read by
+ * all tools instead of turtle, save the next tool in a pipe from having
+ * to scan for statement boundaries again.
+ *
+ * A framed stream starts with FRAME_MAGIC, whose leading NUL can't
+ * start a turtle document, followed by frames, each of which is
+ *   LEB128 varint   (Z << 1) | D
+ *   char[Z]         the statement
+ * with D set for directives.  Statements span from their first
+ * character to their full stop, directives are in @prefix/@base form. */
+
+#define FRAME_MAGIC	"\0ttlfrm\n"
+#define FRAME_MAGIC_LEN	(sizeof(FRAME_MAGIC) - 1U)
+/* maximum length of a frame header */
+#define FRAME_HDRZ	(10U)
+
+struct frame_s {
+	const char *s;
+	size_t z;
+	unsigned int dirp:1;
+};
+
+/**
+ * Return 1 if S of size Z starts with FRAME_MAGIC, 0 if it doesn't,
+ * or -1 if Z is too short to tell. */
+extern int frame_magicp(const char *s, size_t z);
+
+/**
+ * Return the length of the header of a frame of Z bytes. */
+extern size_t frame_hdrz(size_t z);
+
+/**
+ * Write the header of a frame of Z bytes to BUF, which has room for at
+ * least FRAME_HDRZ bytes, DIRP indicating a directive.  Return the
+ * number of bytes written. */
+extern size_t frame_put(char *restrict buf, size_t z, bool dirp);
+
+/**
+ * Read the frame at S, with E marking the end of the buffer, into F.
+ * Return a pointer past the frame or NULL if it's incomplete. */
+extern const char*
+frame_get(struct frame_s *restrict f, const char *s, const char *e);
+
+#endif	/* INCLUDED_frame_h_ */
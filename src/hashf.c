@@ -46,6 +46,7 @@
 #include <fcntl.h>
 #include <sys/stat.h>
 #include <errno.h>
+#include "obuf.h"
 #include "nifty.h"
 #define XXH_INLINE_ALL
 #define XXH_PRIVATE_API
@@ -56,6 +57,9 @@
 #define MB	*(1U<<20)
 #define GB	*(1U<<30)
 
+/* buffered stdout */
+static obuf_t sob;
+
 
 static void
 __attribute__((format(printf, 1, 2)))
@@ -141,7 +145,7 @@ hash1(int fd, const size_t fz, const size_t strd)
 	B[29U] = c2h((h.low64 >> 8U) & 0b1111U);
 	B[30U] = c2h((h.low64 >> 4U) & 0b1111U);
 	B[31U] = c2h((h.low64 >> 0U) & 0b1111U);
-	fwrite(B, 1, 32U, stdout);
+	obuf_write(sob, B, 32U);
 	return 0;
 }
 
@@ -172,6 +176,12 @@ main(int argc, char *argv[])
 		goto out;
 	}
 
+	if (UNLIKELY((sob = make_obuf(STDOUT_FILENO, 0U, 0U)) == NULL)) {
+		error("Error: cannot set up output buffer");
+		rc = 1;
+		goto out;
+	}
+
 	/* read stride length */
 	with (char *ep = NULL) {
 		strd = argi->stride_arg ? strtoul(argi->stride_arg, &ep, 0) : 0U;
@@ -201,7 +211,7 @@ main(int argc, char *argv[])
 
 	if (!argi->nargs) {
 		rc = hash1(STDIN_FILENO, 0U, 0U) < 0;
-		fputc('\n', stdout);
+		obuf_write(sob, "\n", 1U);
 	} else for (size_t i = 0U; i < argi->nargs; i++) {
 		int fd;
 
@@ -211,15 +221,18 @@ Error: cannot open file `%s'", argi->args[i]);
 			rc = 1;
 			continue;
 		}
-		fputs(argi->args[i], stdout);
-		fputc('\t', stdout);
+		obuf_writev(sob, (struct iovec[]){
+				{argi->args[i], strlen(argi->args[i])},
+				{"\t", 1U},
+			}, 2);
 		with (size_t thisfz = fz(fd)) {
 			size_t thistrd = !strp ? strd : thisfz * 100U / strd;
 			rc |= hash1(fd, thisfz, thistrd) < 0;
 		}
 		close(fd);
-		fputc('\n', stdout);
+		obuf_write(sob, "\n", 1U);
 	}
+	rc |= free_obuf(sob) < 0;
 
 out:
 	yuck_free(argi);
@@ -44,6 +44,11 @@
 #include <string.h>
 #include <stdarg.h>
 #include <errno.h>
+#include "range.h"
+#include "obuf.h"
+#if defined RDFSNIPS
+# include "stage.h"
+#endif	/* RDFSNIPS */
 #include "nifty.h"
 
 
@@ -71,6 +76,11 @@ c2h(unsigned int c)
 }
 
 
+/* buffered stdout, stages share stdio's stdout with the other stages
+ * whose summaries must come last */
+static obuf_t sob;
+
+
 /* murmur3 */
 #define HASHSIZE	(128U / 8U)
 
@@ -170,46 +180,112 @@ MurmurHash3_x64_128(const void *key, size_t len, uint8_t out[static HASHSIZE])
 }
 
 
-static int
-fold1(FILE *fp)
+static void
+hash1(const char *s, size_t z)
 {
 	unsigned char H[2U * HASHSIZE + 1U] = {
 		[2U * HASHSIZE] = '\n'
 	};
+	uint8_t h[HASHSIZE];
+
+	MurmurHash3_x64_128(s, z, h);
+
+	/* print hash */
+	for (size_t i = 0U; i < countof(h); i++) {
+		H[2U * i + 0U] = c2h((h[i] >> 0U) & 0b1111U);
+		H[2U * i + 1U] = c2h((h[i] >> 4U) & 0b1111U);
+	}
+
+	if (LIKELY(sob != NULL)) {
+		obuf_write(sob, H, sizeof(H));
+	} else {
+		fwrite(H, 1, sizeof(H), stdout);
+	}
+	return;
+}
+
+static int
+fold1(FILE *fp)
+{
 	char *line = NULL;
 	size_t llen = 0UL;
 
 	for (ssize_t nrd; (nrd = getline(&line, &llen, fp)) > 0;) {
-		uint8_t h[HASHSIZE];
-
 		nrd -= line[nrd - 1] == '\n';
 		line[nrd] = '\n';
 
-		MurmurHash3_x64_128(line, nrd, h);
+		hash1(line, nrd);
+	}
+	return 0;
+}
 
-		/* print hash */
-		for (size_t i = 0U; i < countof(h); i++) {
-			H[2U * i + 0U] = c2h((h[i] >> 0U) & 0b1111U);
-			H[2U * i + 1U] = c2h((h[i] >> 4U) & 0b1111U);
-		}
+static int
+range1(const char *fn, struct range_s rng)
+{
+	struct rmap_s r;
+	int rc = 0;
 
-		fwrite(H, 1, sizeof(H), stdout);
+	if (range_map(&r, fn, rng, true) < 0) {
+		if (errno == ESPIPE) {
+			errno = 0, error("Error: --range needs a regular file");
+		} else {
+			error("Error: cannot open file `%s'", fn);
+		}
+		return -1;
 	}
-	return 0;
+	if (r.end > r.beg) {
+		FILE *fp = fmemopen(deconst(r.m + r.beg), r.end - r.beg, "r");
+
+		if (UNLIKELY(fp == NULL)) {
+			error("Error: cannot read range of `%s'", fn);
+			rc = -1;
+		} else {
+			rc = fold1(fp);
+			fclose(fp);
+		}
+	}
+	range_unmap(&r);
+	return rc;
 }
 
 
 #include "hashl.yucc"
 
+#if !defined RDFSNIPS
 int
 main(int argc, char *argv[])
+#else  /* RDFSNIPS */
+static int
+hashl_main(int argc, char *argv[])
+#endif	/* !RDFSNIPS */
 {
 	yuck_t argi[1U];
+	struct range_s rng;
 	int rc = 0;
 
 	if (yuck_parse(argi, argc, argv) < 0) {
 		rc = 1;
 		goto out;
+	} else if (UNLIKELY((sob = make_obuf(STDOUT_FILENO, 0U, 0U)) == NULL)) {
+		error("Error: cannot set up output buffer");
+		rc = 1;
+		goto out;
+	}
+
+	if (argi->range_arg) {
+		if (range_parse(&rng, argi->range_arg) < 0) {
+			errno = 0, error("\
+Error: cannot parse range `%s', must be START:END", argi->range_arg);
+			rc = 1;
+			goto fin;
+		}
+		if (!argi->nargs) {
+			rc = range1(NULL, rng) < 0;
+		}
+		for (size_t i = 0U; i < argi->nargs; i++) {
+			rc |= range1(argi->args[i], rng) < 0;
+		}
+		goto fin;
 	}
 
 	if (!argi->nargs) {
@@ -227,9 +303,59 @@ Error: cannot open file `%s'", argi->args[i]);
 		fclose(fp);
 	}
 
+fin:
+	rc |= free_obuf(sob) < 0;
 out:
 	yuck_free(argi);
 	return rc;
 }
 
+#if defined RDFSNIPS
+/* as a stage of a fused pipeline, statements rather than lines */
+static yuck_t stg_argi[1U];
+static stage_stmt_f stg_nxt;
+
+static int
+stg_init(int argc, char *argv[], stage_stmt_f nxt, char ***args)
+{
+	int n;
+
+	if (yuck_parse(stg_argi, argc, argv) < 0) {
+		return -1;
+	} else if (stg_argi->range_arg) {
+		errno = 0, error("\
+Error: --range cannot be used in pipelines");
+		return -1;
+	}
+	stg_nxt = nxt;
+	*args = stg_argi->args;
+	n = stg_argi->nargs;
+	stg_argi->nargs = 0U;
+	return n;
+}
+
+static void
+stg_stmt(const char *s, size_t z, const struct scan_s *x)
+{
+	if (!x->dirp) {
+		hash1(s, z);
+	}
+	if (stg_nxt != NULL) {
+		stg_nxt(s, z, x);
+	}
+	return;
+}
+
+static int
+stg_fini(void)
+{
+	yuck_free(stg_argi);
+	return fflush(stdout) < 0;
+}
+
+const struct stage_s stage_hashl = {
+	"hashl", "hashl", hashl_main, stg_init, stg_stmt, stg_fini,
+};
+#endif	/* RDFSNIPS */
+
 /* nquads-fold.c ends here */
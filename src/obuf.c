@@ -0,0 +1,412 @@
+/*** obuf.c -- buffered output
+ *
+ * Copyright (C) 2026 Sebastian Freundt
+ *
+ * Author:  Sebastian Freundt <freundt@ga-group.nl>
+ *
+ * This file is part of rdfsnips.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the author nor the names of any contributors
+ *    may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED.  IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ ***/
+#if defined HAVE_CONFIG_H
+# include "config.h"
+#endif	/* HAVE_CONFIG_H */
+#if defined HAVE_VMSPLICE
+/* for vmsplice() and F_SETPIPE_SZ */
+# define _GNU_SOURCE
+#endif	/* HAVE_VMSPLICE */
+#include <stdlib.h>
+#include <unistd.h>
+#include <stdbool.h>
+#include <string.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include "obuf.h"
+#include "nifty.h"
+
+#if !defined MAP_ANON && defined MAP_ANONYMOUS
+# define MAP_ANON	MAP_ANONYMOUS
+#elif !defined MAP_ANON
+# define MAP_ANON	(0x1000U)
+#endif	/* !MAP_ANON */
+#define PROT_RW		(PROT_READ | PROT_WRITE)
+#define MAP_MEM		(MAP_PRIVATE | MAP_ANON)
+
+#if !defined IOV_MAX
+# define IOV_MAX	(1024)
+#endif	/* !IOV_MAX */
+
+struct obuf_s {
+	int fd;
+	unsigned int flags;
+	/* errno of the first write that failed */
+	int err;
+	/* two buffers, B[CUR] is being filled with N bytes,
+	 * the other one might still be going out */
+	char *b[2U];
+	size_t bsz;
+	size_t n;
+	unsigned int cur;
+
+	/* whether buffers are vmsplice'd into the pipe */
+	bool splp;
+
+	/* background writing, PZ bytes at PB are going out */
+	pthread_t thr;
+	pthread_mutex_t mtx;
+	pthread_cond_t cnd;
+	const char *pb;
+	size_t pz;
+	bool thrp;
+	bool finp;
+};
+
+
+static void
+wr_all(struct obuf_s *o, const char *s, size_t z)
+{
+	for (ssize_t nwr; z > 0U; s += nwr, z -= nwr) {
+		if (UNLIKELY((nwr = write(o->fd, s, z)) <= 0)) {
+			if (nwr < 0 && errno == EINTR) {
+				nwr = 0;
+				continue;
+			}
+			o->err = o->err ?: errno ?: EIO;
+			return;
+		}
+	}
+	return;
+}
+
+#if defined HAVE_VMSPLICE
+static int
+renew(struct obuf_s *o, unsigned int i)
+{
+/* swap the pages of B[I] for fresh ones, vmsplice'd pages are the pipe's
+ * and, through splice(2) or tee(2) on the reading end, possibly other
+ * pipes' or files' for as long as they like, there's no telling when
+ * they've been copied, so we must never write to them again */
+	char *nub;
+
+	if (LIKELY(!madvise(o->b[i], o->bsz, MADV_DONTNEED))) {
+		/* the next touch gets zero-filled pages */
+		return 0;
+	}
+	nub = mmap(NULL, o->bsz, PROT_RW, MAP_MEM, -1, 0);
+	if (UNLIKELY(nub == MAP_FAILED)) {
+		return -1;
+	}
+	munmap(o->b[i], o->bsz);
+	o->b[i] = nub;
+	return 0;
+}
+#endif	/* HAVE_VMSPLICE */
+
+static void
+push(struct obuf_s *o, unsigned int i, size_t z)
+{
+/* write the first Z bytes of B[I] */
+	const char *s = o->b[i];
+
+#if defined HAVE_VMSPLICE
+	if (o->splp) {
+		for (ssize_t nsp; z > 0U; s += nsp, z -= nsp) {
+			struct iovec v = {(void*)deconst(s), z};
+
+			if ((nsp = vmsplice(o->fd, &v, 1, 0)) < 0 && errno == EINTR) {
+				nsp = 0;
+			} else if (nsp <= 0) {
+				break;
+			}
+		}
+		if (UNLIKELY(z > 0U)) {
+			/* no more splicing */
+			wr_all(o, s, z);
+			o->splp = false;
+		}
+		if (UNLIKELY(renew(o, i) < 0)) {
+			/* can't risk overwriting what the pipe holds */
+			o->err = o->err ?: ENOMEM;
+			o->splp = false;
+		}
+		return;
+	}
+#endif	/* HAVE_VMSPLICE */
+	wr_all(o, s, z);
+	return;
+}
+
+static void*
+flusher(void *clo)
+{
+	struct obuf_s *o = clo;
+
+	pthread_mutex_lock(&o->mtx);
+	while (1) {
+		const char *s;
+		size_t z;
+
+		while (!o->pz && !o->finp) {
+			pthread_cond_wait(&o->cnd, &o->mtx);
+		}
+		if (!o->pz) {
+			/* must be finp then */
+			break;
+		}
+		s = o->pb;
+		z = o->pz;
+		pthread_mutex_unlock(&o->mtx);
+
+		wr_all(o, s, z);
+
+		pthread_mutex_lock(&o->mtx);
+		o->pz = 0U;
+		pthread_cond_broadcast(&o->cnd);
+	}
+	pthread_mutex_unlock(&o->mtx);
+	return NULL;
+}
+
+static void
+idle(struct obuf_s *o)
+{
+/* wait for the background writer to be done */
+	if (!o->thrp) {
+		return;
+	}
+	pthread_mutex_lock(&o->mtx);
+	while (o->pz) {
+		pthread_cond_wait(&o->cnd, &o->mtx);
+	}
+	pthread_mutex_unlock(&o->mtx);
+	return;
+}
+
+static void
+flip(struct obuf_s *o)
+{
+/* send the current buffer out and move on to the other one */
+	const unsigned int i = o->cur;
+
+	if (!o->n) {
+		return;
+	} else if (o->thrp) {
+		/* the other buffer must be out before we reuse it */
+		idle(o);
+		pthread_mutex_lock(&o->mtx);
+		o->pb = o->b[i];
+		o->pz = o->n;
+		pthread_cond_broadcast(&o->cnd);
+		pthread_mutex_unlock(&o->mtx);
+	} else {
+		push(o, i, o->n);
+	}
+	o->cur ^= 1U;
+	o->n = 0U;
+	return;
+}
+
+
+obuf_t
+make_obuf(int fd, size_t bsz, unsigned int flags)
+{
+	const size_t pgsz = sysconf(_SC_PAGESIZE);
+	struct obuf_s *r;
+
+	if (UNLIKELY((r = calloc(1, sizeof(*r))) == NULL)) {
+		return NULL;
+	}
+	r->fd = fd;
+	r->flags = flags;
+	r->bsz = bsz ?: OBUF_SIZE;
+
+#if defined HAVE_VMSPLICE
+	with (struct stat st) {
+		int pz;
+
+		if (fstat(fd, &st) < 0 || !S_ISFIFO(st.st_mode)) {
+			break;
+		}
+		/* try and make the pipe as large as a buffer, so that a
+		 * full buffer goes in with one vmsplice */
+		if ((pz = fcntl(fd, F_GETPIPE_SZ)) > 0 && (size_t)pz < r->bsz) {
+			(void)fcntl(fd, F_SETPIPE_SZ, (int)r->bsz);
+			pz = fcntl(fd, F_GETPIPE_SZ);
+		}
+		if (pz <= 0) {
+			break;
+		}
+		r->splp = true;
+		/* pushing is no more than page shuffling then */
+		flags &= ~OBUF_ASYNC;
+	}
+#endif	/* HAVE_VMSPLICE */
+	/* whole pages for splicing */
+	r->bsz = (r->bsz + pgsz - 1U) / pgsz * pgsz;
+	for (size_t i = 0U; i < countof(r->b); i++) {
+		r->b[i] = mmap(NULL, r->bsz, PROT_RW, MAP_MEM, -1, 0);
+		if (UNLIKELY(r->b[i] == MAP_FAILED)) {
+			r->b[i] = NULL;
+			free_obuf(r);
+			return NULL;
+		}
+	}
+	if (flags & OBUF_ASYNC) {
+		pthread_mutex_init(&r->mtx, NULL);
+		pthread_cond_init(&r->cnd, NULL);
+		r->thrp = !pthread_create(&r->thr, NULL, flusher, r);
+		if (!r->thrp) {
+			/* fine, we'll write ourselves */
+			pthread_cond_destroy(&r->cnd);
+			pthread_mutex_destroy(&r->mtx);
+		}
+	}
+	return r;
+}
+
+int
+free_obuf(obuf_t o)
+{
+	int rc;
+
+	if (o->b[0U] != NULL && o->b[1U] != NULL) {
+		(void)obuf_flush(o);
+	}
+	if (o->thrp) {
+		pthread_mutex_lock(&o->mtx);
+		o->finp = true;
+		pthread_cond_broadcast(&o->cnd);
+		pthread_mutex_unlock(&o->mtx);
+		pthread_join(o->thr, NULL);
+		pthread_cond_destroy(&o->cnd);
+		pthread_mutex_destroy(&o->mtx);
+	}
+	for (size_t i = 0U; i < countof(o->b); i++) {
+		if (o->b[i] != NULL) {
+			munmap(o->b[i], o->bsz);
+		}
+	}
+	rc = -(o->err != 0);
+	free(o);
+	return rc;
+}
+
+int
+obuf_write(obuf_t o, const void *s, size_t z)
+{
+	if (UNLIKELY(z > o->bsz - o->n)) {
+		if (z < o->bsz) {
+			/* top up so only full buffers go out */
+			const size_t k = o->bsz - o->n;
+
+			memcpy(o->b[o->cur] + o->n, s, k);
+			o->n += k;
+			s = (const char*)s + k;
+			z -= k;
+			flip(o);
+		} else {
+			/* write through */
+			flip(o);
+			idle(o);
+			wr_all(o, s, z);
+			return -(o->err != 0);
+		}
+	}
+	memcpy(o->b[o->cur] + o->n, s, z);
+	if ((o->n += z) == o->bsz) {
+		flip(o);
+	}
+	return -(o->err != 0);
+}
+
+int
+obuf_writev(obuf_t o, const struct iovec *v, int n)
+{
+	size_t tot = 0U;
+
+	for (int i = 0; i < n; i++) {
+		tot += v[i].iov_len;
+	}
+	if (tot >= o->bsz) {
+		/* gather them straight from the callers */
+		struct iovec w[n];
+
+		memcpy(w, v, n * sizeof(*v));
+		flip(o);
+		idle(o);
+		if (UNLIKELY(wr_iov(o->fd, w, n) < tot)) {
+			o->err = o->err ?: errno ?: EIO;
+		}
+		return -(o->err != 0);
+	}
+	for (int i = 0; i < n; i++) {
+		(void)obuf_write(o, v[i].iov_base, v[i].iov_len);
+	}
+	return -(o->err != 0);
+}
+
+int
+obuf_flush(obuf_t o)
+{
+	flip(o);
+	idle(o);
+	return -(o->err != 0);
+}
+
+size_t
+wr_iov(int fd, struct iovec *v, int n)
+{
+	size_t tot = 0U;
+
+	for (ssize_t nwr; n > 0; tot += nwr) {
+		size_t k;
+
+		if ((nwr = writev(fd, v, n < IOV_MAX ? n : IOV_MAX)) <= 0) {
+			if (nwr < 0 && errno == EINTR) {
+				nwr = 0;
+				continue;
+			}
+			break;
+		}
+		/* skip what's gone out */
+		for (k = nwr; n > 0 && k >= v->iov_len; k -= v->iov_len, v++, n--);
+		if (n > 0) {
+			v->iov_base = (char*)v->iov_base + k;
+			v->iov_len -= k;
+		}
+	}
+	return tot;
+}
+
+/* obuf.c ends here */
@@ -0,0 +1,86 @@
+/*** obuf.h -- buffered output
+ *
+ * Copyright (C) 2026 Sebastian Freundt
+ *
+ * Author:  Sebastian Freundt <freundt@ga-group.nl>
+ *
+ * This file is part of rdfsnips.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the author nor the names of any contributors
+ *    may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED.  IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ ***/
+#if !defined INCLUDED_obuf_h_
+#define INCLUDED_obuf_h_
+#include <stddef.h>
+#include <sys/uio.h>
+
+/* Buffered output to a file descriptor.  Writes are collected in large
+ * buffers and go out a buffer at a time, optionally from a background
+ * thread so formatting and writing overlap.  If the descriptor is a
+ * pipe and the system has vmsplice(2), full buffers are handed to the
+ * pipe without being copied and get fresh pages afterwards, the pipe's
+ * reader may keep the old ones, such buffers are synchronous then. */
+
+typedef struct obuf_s *obuf_t;
+
+/* default buffer size */
+#define OBUF_SIZE	(1024U * 1024U)
+
+/* flags */
+#define OBUF_ASYNC	(1U)
+
+/**
+ * Create an output buffer of BSZ bytes, or OBUF_SIZE if 0, for FD.
+ * With OBUF_ASYNC in FLAGS buffers are written by a background thread. */
+extern obuf_t make_obuf(int fd, size_t bsz, unsigned int flags);
+
+/**
+ * Flush and free O, the descriptor is left open.
+ * Return -1 if any of the writes failed, 0 otherwise. */
+extern int free_obuf(obuf_t o);
+
+/**
+ * Append S of length Z to O, large writes bypass the buffer.
+ * Return -1 if writing has failed so far, 0 otherwise. */
+extern int obuf_write(obuf_t o, const void *s, size_t z);
+
+/**
+ * Append the N segments of V to O, gathering them into one writev(2)
+ * if they bypass the buffer.  Return like obuf_write(). */
+extern int obuf_writev(obuf_t o, const struct iovec *v, int n);
+
+/**
+ * Write out what's buffered in O and wait for it to have gone out. */
+extern int obuf_flush(obuf_t o);
+
+/**
+ * Write all N segments of V to FD with as few writev(2) calls as
+ * possible, V is clobbered.  Return the number of bytes written. */
+extern size_t wr_iov(int fd, struct iovec *v, int n);
+
+#endif	/* INCLUDED_obuf_h_ */
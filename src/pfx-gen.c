@@ -0,0 +1,117 @@
+/*** pfx-gen.c -- compile a namespace dictionary into C
+ *
+ * Copyright (C) 2026 Sebastian Freundt
+ *
+ * Author:  Sebastian Freundt <freundt@ga-group.nl>
+ *
+ * This file is part of rdfsnips.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the author nor the names of any contributors
+ *    may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED.  IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ ***/
+#if defined HAVE_CONFIG_H
+# include "config.h"
+#endif	/* HAVE_CONFIG_H */
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+#include "pfxdict.h"
+#include "nifty.h"
+
+/* Read @prefix lines, like those in well-known.ttl, from FILE and
+ * print them as a namespace dictionary image in C, pfx-builtin.h,
+ * for ttl-prefixify to include.  Anything but @prefix lines is
+ * ignored. */
+
+int
+main(int argc, char *argv[])
+{
+	struct pfxdict_kv_s *kv = NULL;
+	size_t nkv = 0U, zkv = 0U;
+	char *line = NULL;
+	size_t llen = 0U;
+	unsigned char *img;
+	size_t imgz;
+	FILE *fp;
+
+	if (argc < 2) {
+		fputs("Usage: pfx-gen FILE\n", stderr);
+		return 1;
+	} else if ((fp = fopen(argv[1], "r")) == NULL) {
+		perror(argv[1]);
+		return 1;
+	}
+	for (ssize_t nrd; (nrd = getline(&line, &llen, fp)) > 0;) {
+		char *p, *pe, *u, *ue;
+
+		if (strncmp(line, "@prefix", 7U) || !isspace(line[7U])) {
+			continue;
+		}
+		for (p = line + 8U; isspace(*p); p++);
+		if ((pe = strchr(p, ':')) == NULL) {
+			continue;
+		} else if ((u = strchr(pe, '<')) == NULL) {
+			continue;
+		} else if ((ue = strchr(++u, '>')) == NULL) {
+			continue;
+		}
+		if (nkv >= zkv) {
+			zkv = zkv ? zkv << 1U : 256U;
+			kv = realloc(kv, zkv * sizeof(*kv));
+		}
+		kv[nkv++] = (struct pfxdict_kv_s){
+			strndup(p, pe - p), pe - p, strndup(u, ue - u), ue - u,
+		};
+	}
+	fclose(fp);
+
+	if ((img = pfxdict_make(&imgz, kv, nkv)) == NULL) {
+		fputs("Error: cannot build dictionary\n", stderr);
+		return 1;
+	}
+	printf("/* generated by pfx-gen from %s, %zu namespaces */\n",
+	       argv[1], pfxdict_nent(img));
+	printf("static const unsigned char "
+	       "ALGN(pfx_builtin[%zu], 8U) = {", imgz);
+	for (size_t i = 0U; i < imgz; i++) {
+		printf("%s0x%02x,", i % 12U ? " " : "\n\t", img[i]);
+	}
+	puts("\n};");
+
+	free(img);
+	for (size_t i = 0U; i < nkv; i++) {
+		free(deconst(kv[i].pf));
+		free(deconst(kv[i].ns));
+	}
+	free(kv);
+	free(line);
+	return 0;
+}
+
+/* pfx-gen.c ends here */
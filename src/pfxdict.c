@@ -0,0 +1,302 @@
+/*** pfxdict.c -- perfect-hashed namespace dictionaries
+ *
+ * Copyright (C) 2026 Sebastian Freundt
+ *
+ * Author:  Sebastian Freundt <freundt@ga-group.nl>
+ *
+ * This file is part of rdfsnips.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the author nor the names of any contributors
+ *    may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED.  IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ ***/
+#if defined HAVE_CONFIG_H
+# include "config.h"
+#endif	/* HAVE_CONFIG_H */
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include "pfxdict.h"
+#include "nifty.h"
+
+/* Hash and displace: keys are hashed into NBKT buckets, and every
+ * bucket gets a displacement D such that its keys land in distinct
+ * free slots at (lo + D * hi) % NSLOT, lo and hi being the halves of
+ * the key's hash.  Buckets are placed biggest first. */
+
+/* give up on a bucket beyond this */
+#define MAX_DISP	(1U << 24U)
+
+static __attribute__((pure)) uint64_t
+hash_str(const char *s, size_t z)
+{
+	/* FNV-1a */
+	uint64_t h = 0xcbf29ce484222325ULL;
+
+	for (size_t i = 0U; i < z; i++) {
+		h ^= (unsigned char)s[i];
+		h *= 0x100000001b3ULL;
+	}
+	/* FNV's upper half is weak, mix it down a bit */
+	h ^= h >> 29U;
+	h *= 0xbf58476d1ce4e5b9ULL;
+	h ^= h >> 32U;
+	return h;
+}
+
+static inline __attribute__((pure)) size_t
+slot(uint64_t h, uint32_t d, uint32_t nslot)
+{
+	const uint64_t lo = (uint32_t)h;
+	const uint64_t hi = (uint32_t)(h >> 32U) | 1U;
+
+	return (size_t)((lo + d * hi) % nslot);
+}
+
+#define DISP(img)	((const uint32_t*)((const struct pfxdict_hdr_s*)(img) + 1U))
+#define ENTS(img)							\
+	((const struct pfxdict_ent_s*)					\
+	 (DISP(img) + ((const struct pfxdict_hdr_s*)(img))->nbkt))
+#define STRS(img)							\
+	((const char*)							\
+	 (ENTS(img) + ((const struct pfxdict_hdr_s*)(img))->nslot))
+
+
+void*
+pfxdict_make(size_t *z, const struct pfxdict_kv_s *kv, size_t n)
+{
+	struct pfxdict_hdr_s *hdr;
+	struct pfxdict_ent_s *ent;
+	uint64_t *h = NULL;
+	/* keys by bucket, bucket B's are bix[bof[B]] to bix[bof[B] + bsz[B]] */
+	size_t *bix = NULL;
+	size_t *bof = NULL;
+	size_t *bsz = NULL;
+	/* buckets by size */
+	size_t *ord = NULL;
+	uint32_t *disp = NULL;
+	uint32_t *sl = NULL;
+	bool *used = NULL;
+	uint32_t nbkt, nslot;
+	size_t nk = 0U;
+	size_t maxb = 0U;
+	size_t nord = 0U;
+	size_t imgz, strz = 0U;
+	char *str;
+	void *img = NULL;
+
+	if (UNLIKELY(n >= 0x40000000U)) {
+		return NULL;
+	}
+	nbkt = n / 4U + 1U;
+	nslot = n + n / 4U + 1U;
+	h = malloc(n * sizeof(*h) + 1U);
+	bix = malloc(n * sizeof(*bix) + 1U);
+	bof = calloc(nbkt + 1U, sizeof(*bof));
+	bsz = calloc(nbkt, sizeof(*bsz));
+	ord = malloc(nbkt * sizeof(*ord));
+	disp = calloc(nbkt, sizeof(*disp));
+	sl = malloc(n * sizeof(*sl) + 1U);
+	used = calloc(nslot, sizeof(*used));
+	if (UNLIKELY(h == NULL || bix == NULL || bof == NULL || bsz == NULL ||
+		     ord == NULL || disp == NULL || sl == NULL || used == NULL)) {
+		goto out;
+	}
+
+	/* hash and sort keys into buckets */
+	for (size_t i = 0U; i < n; i++) {
+		h[i] = hash_str(kv[i].ns, kv[i].nsz);
+		bof[h[i] % nbkt + 1U]++;
+	}
+	for (size_t b = 0U; b < nbkt; b++) {
+		bof[b + 1U] += bof[b];
+	}
+	for (size_t i = 0U; i < n; i++) {
+		const size_t b = h[i] % nbkt;
+		size_t k;
+
+		if (UNLIKELY(!kv[i].nsz)) {
+			continue;
+		}
+		/* same namespaces end up in the same bucket */
+		for (k = bof[b]; k < bof[b] + bsz[b]; k++) {
+			const size_t j = bix[k];
+
+			if (h[j] == h[i] && kv[j].nsz == kv[i].nsz &&
+			    !memcmp(kv[j].ns, kv[i].ns, kv[i].nsz)) {
+				break;
+			}
+		}
+		if (k == bof[b] + bsz[b]) {
+			bix[k] = i;
+			bsz[b]++;
+			nk++;
+			maxb = bsz[b] > maxb ? bsz[b] : maxb;
+		}
+	}
+	/* biggest buckets first, empty ones needn't be placed */
+	for (size_t m = maxb; m > 0U; m--) {
+		for (size_t b = 0U; b < nbkt; b++) {
+			if (bsz[b] == m) {
+				ord[nord++] = b;
+			}
+		}
+	}
+
+	/* displace */
+	for (size_t o = 0U; o < nord; o++) {
+		const size_t b = ord[o];
+		const size_t *k0 = bix + bof[b];
+		uint32_t *s0 = sl + bof[b];
+		uint32_t d = 0U;
+
+	retry:
+		if (UNLIKELY(d >= MAX_DISP)) {
+			goto out;
+		}
+		for (size_t k = 0U; k < bsz[b]; k++) {
+			s0[k] = slot(h[k0[k]], d, nslot);
+			if (used[s0[k]]) {
+				goto next;
+			}
+			for (size_t l = 0U; l < k; l++) {
+				if (s0[l] == s0[k]) {
+					goto next;
+				}
+			}
+		}
+		for (size_t k = 0U; k < bsz[b]; k++) {
+			used[s0[k]] = true;
+		}
+		disp[b] = d;
+		continue;
+	next:
+		d++;
+		goto retry;
+	}
+
+	/* assemble the image */
+	for (size_t b = 0U; b < nbkt; b++) {
+		for (size_t k = bof[b]; k < bof[b] + bsz[b]; k++) {
+			strz += kv[bix[k]].nsz + kv[bix[k]].pfz;
+		}
+	}
+	imgz = sizeof(*hdr) + nbkt * sizeof(*disp) +
+		nslot * sizeof(*ent) + strz;
+	if (UNLIKELY(strz >= 0xffffffffU || (img = calloc(1U, imgz)) == NULL)) {
+		goto out;
+	}
+	hdr = img;
+	memcpy(hdr->magic, PFXDICT_MAGIC, sizeof(hdr->magic));
+	hdr->nent = nk;
+	hdr->nbkt = nbkt;
+	hdr->nslot = nslot;
+	hdr->strz = strz;
+	memcpy(hdr + 1U, disp, nbkt * sizeof(*disp));
+	ent = (void*)((uint32_t*)(hdr + 1U) + nbkt);
+	str = (void*)(ent + nslot);
+	strz = 0U;
+	for (size_t b = 0U; b < nbkt; b++) {
+		for (size_t k = bof[b]; k < bof[b] + bsz[b]; k++) {
+			const struct pfxdict_kv_s *x = kv + bix[k];
+			struct pfxdict_ent_s *e = ent + sl[k];
+
+			e->ns = strz;
+			e->nsz = x->nsz;
+			memcpy(str + strz, x->ns, x->nsz);
+			strz += x->nsz;
+			e->pf = strz;
+			e->pfz = x->pfz;
+			memcpy(str + strz, x->pf, x->pfz);
+			strz += x->pfz;
+		}
+	}
+	*z = imgz;
+out:
+	free(h);
+	free(bix);
+	free(bof);
+	free(bsz);
+	free(ord);
+	free(disp);
+	free(sl);
+	free(used);
+	return img;
+}
+
+int
+pfxdict_chk(const void *img, size_t z)
+{
+	const struct pfxdict_hdr_s *hdr = img;
+
+	if (UNLIKELY(z < sizeof(*hdr))) {
+		return -1;
+	} else if (UNLIKELY(memcmp(hdr->magic, PFXDICT_MAGIC,
+				   sizeof(hdr->magic)))) {
+		return -1;
+	} else if (UNLIKELY(!hdr->nbkt || !hdr->nslot)) {
+		return -1;
+	} else if (UNLIKELY(sizeof(*hdr) +
+			    (uint64_t)hdr->nbkt * sizeof(uint32_t) +
+			    (uint64_t)hdr->nslot * sizeof(struct pfxdict_ent_s) +
+			    hdr->strz != z)) {
+		return -1;
+	}
+	/* entries must be within the strings */
+	for (size_t i = 0U; i < hdr->nslot; i++) {
+		const struct pfxdict_ent_s *e = ENTS(img) + i;
+
+		if (UNLIKELY((uint64_t)e->ns + e->nsz > hdr->strz ||
+			     (uint64_t)e->pf + e->pfz > hdr->strz)) {
+			return -1;
+		}
+	}
+	return 0;
+}
+
+const char*
+pfxdict_get(const void *img, const char *ns, size_t nsz, size_t *pfz)
+{
+	const struct pfxdict_hdr_s *hdr = img;
+	const uint64_t h = hash_str(ns, nsz);
+	const uint32_t d = DISP(img)[h % hdr->nbkt];
+	const struct pfxdict_ent_s *e = ENTS(img) + slot(h, d, hdr->nslot);
+
+	if (!nsz || e->nsz != nsz || memcmp(STRS(img) + e->ns, ns, nsz)) {
+		return NULL;
+	}
+	*pfz = e->pfz;
+	return STRS(img) + e->pf;
+}
+
+size_t
+pfxdict_nent(const void *img)
+{
+	return ((const struct pfxdict_hdr_s*)img)->nent;
+}
+
+/* pfxdict.c ends here */
@@ -0,0 +1,96 @@
+/*** pfxdict.h -- perfect-hashed namespace dictionaries
+ *
+ * Copyright (C) 2026 Sebastian Freundt
+ *
+ * Author:  Sebastian Freundt <freundt@ga-group.nl>
+ *
+ * This file is part of rdfsnips.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the author nor the names of any contributors
+ *    may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED.  IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ ***/
+#if !defined INCLUDED_pfxdict_h_
+#define INCLUDED_pfxdict_h_
+#include <stddef.h>
+#include <stdint.h>
+
+/* A namespace dictionary maps namespace IRIs to prefix names.  It's a
+ * single image, position independent and in host byte order, so the
+ * same lookup works on a table compiled into a tool and on a file
+ * mmap()ed from disk:
+ *   struct pfxdict_hdr_s
+ *   uint32_t[nbkt]               displacements, see pfxdict.c
+ *   struct pfxdict_ent_s[nslot]  unused slots have nsz == 0
+ *   char[strz]                   namespaces and prefixes */
+
+#define PFXDICT_MAGIC	"pfxdct1\n"
+
+struct pfxdict_hdr_s {
+	char magic[8U];
+	uint32_t nent;
+	uint32_t nbkt;
+	uint32_t nslot;
+	uint32_t strz;
+};
+
+struct pfxdict_ent_s {
+	/* offsets and lengths of namespace and prefix in the strings */
+	uint32_t ns;
+	uint32_t nsz;
+	uint32_t pf;
+	uint32_t pfz;
+};
+
+struct pfxdict_kv_s {
+	const char *pf;
+	size_t pfz;
+	const char *ns;
+	size_t nsz;
+};
+
+/**
+ * Build an image of the N prefix/namespace pairs in KV, return it
+ * and its size in *Z, or NULL on failure.  Of pairs with the same
+ * namespace the first one is kept.  The image is to be free()d. */
+extern void *pfxdict_make(size_t *z, const struct pfxdict_kv_s *kv, size_t n);
+
+/**
+ * Return 0 if the Z bytes in IMG are a usable image, -1 otherwise. */
+extern int pfxdict_chk(const void *img, size_t z);
+
+/**
+ * Return the prefix for namespace NS of length NSZ and its length
+ * in *PFZ, or NULL if IMG doesn't know NS. */
+extern const char*
+pfxdict_get(const void *img, const char *ns, size_t nsz, size_t *pfz);
+
+/**
+ * Return the number of entries in IMG. */
+extern size_t pfxdict_nent(const void *img);
+
+#endif	/* INCLUDED_pfxdict_h_ */
@@ -0,0 +1,181 @@
+/*** pool.c -- simple thread pool
+ *
+ * Copyright (C) 2026 Sebastian Freundt
+ *
+ * Author:  Sebastian Freundt <freundt@ga-group.nl>
+ *
+ * This file is part of rdfsnips.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the author nor the names of any contributors
+ *    may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED.  IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ ***/
+#if defined HAVE_CONFIG_H
+# include "config.h"
+#endif	/* HAVE_CONFIG_H */
+#include <stdlib.h>
+#include <unistd.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include "pool.h"
+#include "nifty.h"
+
+struct job_s {
+	void(*fn)(void*);
+	void *arg;
+};
+
+struct pool_s {
+	pthread_mutex_t mtx;
+	/* signalled when jobs are added, or when we're going down */
+	pthread_cond_t jobc;
+	/* signalled when a slot becomes free or a worker goes idle */
+	pthread_cond_t idlc;
+	size_t qlen;
+	size_t qhd;
+	size_t nq;
+	unsigned int nbusy;
+	unsigned int nthr;
+	bool finp;
+	pthread_t *thr;
+	struct job_s q[];
+};
+
+
+static void*
+work(void *clo)
+{
+	struct pool_s *p = clo;
+
+	pthread_mutex_lock(&p->mtx);
+	while (1) {
+		struct job_s j;
+
+		while (!p->nq && !p->finp) {
+			pthread_cond_wait(&p->jobc, &p->mtx);
+		}
+		if (!p->nq) {
+			/* must be finp then */
+			break;
+		}
+		/* dequeue */
+		j = p->q[p->qhd];
+		p->qhd = (p->qhd + 1U) % p->qlen;
+		p->nq--;
+		p->nbusy++;
+		pthread_cond_broadcast(&p->idlc);
+		pthread_mutex_unlock(&p->mtx);
+
+		j.fn(j.arg);
+
+		pthread_mutex_lock(&p->mtx);
+		p->nbusy--;
+		pthread_cond_broadcast(&p->idlc);
+	}
+	pthread_mutex_unlock(&p->mtx);
+	return NULL;
+}
+
+
+pool_t
+make_pool(unsigned int nthr, size_t qlen)
+{
+	struct pool_s *r;
+
+	if (!nthr) {
+		long int ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+		nthr = ncpu > 0 ? (unsigned int)ncpu : 1U;
+	}
+	if (!qlen) {
+		qlen = 2U * nthr;
+	}
+	if (UNLIKELY((r = calloc(1, sizeof(*r) + qlen * sizeof(*r->q))) == NULL)) {
+		return NULL;
+	} else if (UNLIKELY((r->thr = calloc(nthr, sizeof(*r->thr))) == NULL)) {
+		free(r);
+		return NULL;
+	}
+	pthread_mutex_init(&r->mtx, NULL);
+	pthread_cond_init(&r->jobc, NULL);
+	pthread_cond_init(&r->idlc, NULL);
+	r->qlen = qlen;
+	for (; r->nthr < nthr; r->nthr++) {
+		if (pthread_create(r->thr + r->nthr, NULL, work, r)) {
+			break;
+		}
+	}
+	if (UNLIKELY(!r->nthr)) {
+		free_pool(r);
+		return NULL;
+	}
+	return r;
+}
+
+void
+free_pool(pool_t p)
+{
+	pthread_mutex_lock(&p->mtx);
+	p->finp = true;
+	pthread_cond_broadcast(&p->jobc);
+	pthread_mutex_unlock(&p->mtx);
+
+	for (unsigned int i = 0U; i < p->nthr; i++) {
+		pthread_join(p->thr[i], NULL);
+	}
+	pthread_cond_destroy(&p->idlc);
+	pthread_cond_destroy(&p->jobc);
+	pthread_mutex_destroy(&p->mtx);
+	free(p->thr);
+	free(p);
+	return;
+}
+
+int
+pool_push(pool_t p, void(*fn)(void*), void *arg)
+{
+	pthread_mutex_lock(&p->mtx);
+	while (p->nq >= p->qlen) {
+		pthread_cond_wait(&p->idlc, &p->mtx);
+	}
+	p->q[(p->qhd + p->nq++) % p->qlen] = (struct job_s){fn, arg};
+	pthread_cond_signal(&p->jobc);
+	pthread_mutex_unlock(&p->mtx);
+	return 0;
+}
+
+void
+pool_wait(pool_t p)
+{
+	pthread_mutex_lock(&p->mtx);
+	while (p->nq || p->nbusy) {
+		pthread_cond_wait(&p->idlc, &p->mtx);
+	}
+	pthread_mutex_unlock(&p->mtx);
+	return;
+}
+
+/* pool.c ends here */
@@ -0,0 +1,268 @@
+/*** range.c -- byte ranges of input files
+ *
+ * Copyright (C) 2026 Sebastian Freundt
+ *
+ * Author:  Sebastian Freundt <freundt@ga-group.nl>
+ *
+ * This file is part of rdfsnips.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the author nor the names of any contributors
+ *    may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED.  IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ ***/
+#if defined HAVE_CONFIG_H
+# include "config.h"
+#endif	/* HAVE_CONFIG_H */
+#include <stdlib.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <string.h>
+#include <strings.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "range.h"
+#include "term.h"
+#include "nifty.h"
+
+/* statements that must follow a boundary found heuristically */
+#define RANGE_NCHK	(4U)
+
+
+static int
+parse_size(size_t *restrict z, const char *s, const char **on)
+{
+	unsigned long long v;
+	char *x;
+
+	if (*s == ':' || *s == '\0') {
+		/* omitted, keep default */
+		*on = s;
+		return 0;
+	}
+	v = strtoull(s, &x, 10);
+	if (x == s) {
+		return -1;
+	}
+	switch (*x) {
+	case 'G':
+		v <<= 10U;
+		/* fallthrough */
+	case 'M':
+		v <<= 10U;
+		/* fallthrough */
+	case 'k':
+	case 'K':
+		v <<= 10U;
+		x++;
+		break;
+	default:
+		break;
+	}
+	*z = (size_t)v;
+	*on = x;
+	return 0;
+}
+
+static size_t
+stmt_bnd(const struct rmap_s *r, size_t hz, size_t off)
+{
+/* first statement boundary at or beyond OFF */
+	const char *bo;
+
+	if (off == 0U) {
+		return 0U;
+	} else if (off <= hz) {
+		/* right after the directives at the top */
+		return hz;
+	} else if (off >= r->mz) {
+		return r->mz;
+	} else if (r->x != NULL) {
+		const size_t o = ttlidx_find(r->x, off, NULL);
+		return o < r->mz ? o : r->mz;
+	} else if ((bo = term_resync(r->m + off, r->m + r->mz,
+				     RANGE_NCHK)) != NULL) {
+		return bo - r->m;
+	}
+	return r->mz;
+}
+
+static size_t
+line_bnd(const struct rmap_s *r, size_t off)
+{
+/* first line beginning at or beyond OFF */
+	const char *lp;
+
+	if (off == 0U) {
+		return 0U;
+	} else if (off >= r->mz) {
+		return r->mz;
+	} else if ((lp = memchr(r->m + off - 1U, '\n',
+				r->mz - off + 1U)) != NULL) {
+		return lp + 1U - r->m;
+	}
+	return r->mz;
+}
+
+
+int
+range_parse(struct range_s *restrict r, const char *spec)
+{
+	const char *on;
+
+	r->beg = 0U;
+	r->end = (size_t)-1;
+	if (parse_size(&r->beg, spec, &on) < 0 || *on++ != ':') {
+		return -1;
+	} else if (parse_size(&r->end, on, &on) < 0 || *on) {
+		return -1;
+	}
+	return r->beg <= r->end ? 0 : -1;
+}
+
+static bool
+kwp(const char *s, const char *ep, const char *kw, size_t kz)
+{
+/* sparql style directive keyword KW at S, the keyword must be followed
+ * by whitespace or an IRI lest we mistake base:x for a directive */
+	if (ep - s <= (ptrdiff_t)kz || strncasecmp(s, kw, kz)) {
+		return false;
+	}
+	switch (s[kz]) {
+	case ' ':
+	case '\t':
+	case '\n':
+	case '\r':
+	case '<':
+		return true;
+	default:
+		break;
+	}
+	return false;
+}
+
+size_t
+range_head(const char *s, size_t z)
+{
+	const char *const ep = s + z;
+	const char *hp = s;
+
+	for (const char *tp;
+	     (tp = term_skip(hp, ep)) < ep &&
+		     (*tp == '@' ||
+		      kwp(tp, ep, "PREFIX", 6U) ||
+		      kwp(tp, ep, "BASE", 4U));) {
+		const char *x;
+
+		if (*tp == '@') {
+			x = term_stmt_end(tp, ep);
+		} else if ((x = memchr(tp, '>', ep - tp)) != NULL) {
+			/* sparql style, no full stop */
+			x++;
+		}
+		if (x == NULL) {
+			break;
+		}
+		hp = x;
+	}
+	return hp - s;
+}
+
+int
+range_map(struct rmap_s *restrict r, const char *fn,
+	  struct range_s rng, bool linep)
+{
+	struct stat st;
+	size_t hz;
+	int fd;
+
+	*r = (struct rmap_s){NULL};
+	if (fn == NULL) {
+		errno = ESPIPE;
+		return -1;
+	} else if ((fd = open(fn, O_RDONLY)) < 0) {
+		return -1;
+	} else if (fstat(fd, &st) < 0) {
+		goto fuck;
+	} else if (!S_ISREG(st.st_mode)) {
+		errno = ESPIPE;
+		goto fuck;
+	} else if ((r->mz = st.st_size) > 0U) {
+		void *m = mmap(NULL, r->mz, PROT_READ, MAP_SHARED, fd, 0);
+
+		if (UNLIKELY(m == MAP_FAILED)) {
+			goto fuck;
+		}
+		(void)madvise(m, r->mz, MADV_SEQUENTIAL);
+		r->m = m;
+	}
+	close(fd);
+
+	if (linep) {
+		r->beg = line_bnd(r, rng.beg);
+		r->end = line_bnd(r, rng.end);
+		return 0;
+	}
+	/* if there's an index, use it, otherwise resync heuristically */
+	with (char ifn[4096U]) {
+		snprintf(ifn, sizeof(ifn), "%s.ttlidx", fn);
+		r->x = ttlidx_open(ifn, &st);
+	}
+	hz = range_head(r->m, r->mz);
+	r->beg = stmt_bnd(r, hz, rng.beg);
+	r->end = stmt_bnd(r, hz, rng.end);
+	if (r->beg > hz && r->beg < r->end && r->x != NULL) {
+		/* the index knows the directives in effect */
+		ttlidx_find(r->x, r->beg, &r->hdrz);
+		r->hdr = ttlidx_dirs(r->x, NULL);
+	} else if (r->beg > 0U && r->beg < r->end) {
+		r->hdr = r->m;
+		r->hdrz = hz;
+	}
+	return 0;
+
+fuck:
+	close(fd);
+	return -1;
+}
+
+void
+range_unmap(struct rmap_s *restrict r)
+{
+	if (r->x != NULL) {
+		free_ttlidx(r->x);
+	}
+	if (r->m != NULL) {
+		munmap(deconst(r->m), r->mz);
+	}
+	*r = (struct rmap_s){NULL};
+	return;
+}
+
+/* range.c ends here */
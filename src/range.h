@@ -0,0 +1,90 @@
+/*** range.h -- byte ranges of input files
+ *
+ * Copyright (C) 2026 Sebastian Freundt
+ *
+ * Author:  Sebastian Freundt <freundt@ga-group.nl>
+ *
+ * This file is part of rdfsnips.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the author nor the names of any contributors
+ *    may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED.  IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ ***/
+#if !defined INCLUDED_range_h_
+#define INCLUDED_range_h_
+#include <stddef.h>
+#include <stdbool.h>
+#include "ttlidx.h"
+
+/* Byte ranges START:END of input files, so independent processes can
+ * share the work on one big file.  Both ends are moved forward to the
+ * next statement boundary (or line boundary), and because every process
+ * does that the same way, adjacent ranges neither overlap nor leave a
+ * gap.  Boundaries are looked up in FILE.ttlidx if there is one, which
+ * makes them exact, and are found by term_resync() otherwise. */
+
+struct range_s {
+	size_t beg;
+	size_t end;
+};
+
+struct rmap_s {
+	/* the mapped file */
+	const char *m;
+	size_t mz;
+	/* directives in effect at BEG, to be processed first */
+	const char *hdr;
+	size_t hdrz;
+	/* the range, moved to boundaries */
+	size_t beg;
+	size_t end;
+
+	ttlidx_t x;
+};
+
+/**
+ * Parse SPEC of the form START:END into R.  Either side may be omitted,
+ * sizes may be suffixed by k, M or G.  Return 0 on success, -1 if SPEC
+ * is no good. */
+extern int range_parse(struct range_s *restrict r, const char *spec);
+
+/**
+ * Return the length of the block of directives at the beginning of S. */
+extern size_t range_head(const char *s, size_t z);
+
+/**
+ * Map regular file FN and move the ends of range R to statement
+ * boundaries, or to line boundaries if LINEP.  Return 0 on success or
+ * -1 with errno set. */
+extern int range_map(struct rmap_s *restrict, const char *fn,
+		     struct range_s r, bool linep);
+
+/**
+ * Unmap file and free resources obtained by range_map(). */
+extern void range_unmap(struct rmap_s *restrict);
+
+#endif	/* INCLUDED_range_h_ */
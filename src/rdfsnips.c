@@ -0,0 +1,385 @@
+/*** rdfsnips.c -- run several snips over one scan of the input
+ *
+ * Copyright (C) 2026 Sebastian Freundt
+ *
+ * Author:  Sebastian Freundt <freundt@ga-group.nl>
+ *
+ * This file is part of rdfsnips.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the author nor the names of any contributors
+ *    may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED.  IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ ***/
+#if defined HAVE_CONFIG_H
+# include "config.h"
+#endif	/* HAVE_CONFIG_H */
+#include <stdlib.h>
+#include <unistd.h>
+#include <stdbool.h>
+#include <sys/mman.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdarg.h>
+#include <fcntl.h>
+#include <errno.h>
+#include "scan.h"
+#include "frame.h"
+#include "stage.h"
+#include "nifty.h"
+
+#if !defined MAP_ANON && defined MAP_ANONYMOUS
+# define MAP_ANON	MAP_ANONYMOUS
+#elif !defined MAP_ANON
+# define MAP_ANON	(0x1000U)
+#endif	/* !MAP_ANON */
+#define PROT_RW		(PROT_READ | PROT_WRITE)
+#define MAP_MEM		(MAP_PRIVATE | MAP_ANON)
+
+static const struct stage_s *const stages[] = {
+	&stage_ttl_prefixify,
+	&stage_ttl_split,
+	&stage_ttl_wc,
+	&stage_hashl,
+};
+
+/* the pipeline */
+static const struct stage_s *pipe_[countof(stages)];
+static size_t npipe;
+
+/* scanner state */
+static struct scan_s scn;
+
+/* whether the input is framed, -1 for don't know yet,
+ * 1 if there's still the magic to skip */
+static int frmi;
+
+
+/* helpers */
+static void
+__attribute__((format(printf, 1, 2)))
+error(const char *fmt, ...)
+{
+	va_list vap;
+	va_start(vap, fmt);
+	vfprintf(stderr, fmt, vap);
+	va_end(vap);
+	if (errno) {
+		fputc(':', stderr);
+		fputc(' ', stderr);
+		fputs(strerror(errno), stderr);
+	}
+	fputc('\n', stderr);
+	return;
+}
+
+static void*
+resz(void *buf, size_t old, size_t new)
+{
+	void *nub = mmap(NULL, new, PROT_RW, MAP_MEM, -1, 0);
+
+	if (UNLIKELY(nub == MAP_FAILED)) {
+		return NULL;
+	}
+	(void)memcpy(nub, buf, old);
+	return nub;
+}
+
+#define RESZ(_b, _oz, _nz)						\
+	size_t _nuz_ = _nz;						\
+	void *_nub_ = resz(_b, _oz, _nuz_);				\
+	if (LIKELY(_nub_ != NULL)) {					\
+		_b = _nub_;						\
+		_oz = _nuz_;						\
+	}
+
+static const struct stage_s*
+find_stage(const char *name)
+{
+	for (size_t i = 0U; i < countof(stages); i++) {
+		if (!strcmp(name, stages[i]->name) ||
+		    !strcmp(name, stages[i]->tool)) {
+			return stages[i];
+		}
+	}
+	return NULL;
+}
+
+
+/* the actual scanning */
+static ssize_t
+proc(const char *buf, size_t bsz, bool lastp)
+{
+	const char *sp = buf;
+	const char *const ep = buf + bsz;
+	const char *bo;
+
+#define fini_proc()	proc(NULL, 0U, false)
+	if (UNLIKELY(buf == NULL)) {
+		/* and finalise */
+		memset(&scn, 0, sizeof(scn));
+		return 0;
+	}
+
+	for (const char *eo;
+	     (eo = (lastp ? scan_last : scan_stmt)(&scn, &bo, sp, ep)) != NULL;
+	     sp = eo) {
+		if (UNLIKELY(scn.dirp && *bo != '@')) {
+			/* stages see turtle directives only */
+			char dir[4096U];
+			size_t z;
+
+			if ((z = scan_dir(dir, sizeof(dir), bo, eo - bo))) {
+				pipe_[0U]->stmt(dir, z, &scn);
+			}
+			continue;
+		}
+		pipe_[0U]->stmt(bo, eo - bo, &scn);
+	}
+	return bo - buf;
+}
+
+static ssize_t
+proc_frm(const char *buf, size_t bsz, bool lastp)
+{
+/* like proc() but for framed input */
+	const char *sp = buf;
+	const char *const ep = buf + bsz;
+	struct frame_s f;
+
+	if (UNLIKELY(frmi == 1)) {
+		sp += FRAME_MAGIC_LEN;
+		frmi = 2;
+	}
+	for (const char *eo; (eo = frame_get(&f, sp, ep)) != NULL; sp = eo) {
+		const char *bo;
+
+		/* frames hold exactly one statement, scan it for the
+		 * benefit of stages that want to know its shape */
+		memset(&scn, 0, sizeof(scn));
+		if (!f.dirp) {
+			(void)scan_last(&scn, &bo, f.s, f.s + f.z);
+		}
+		scn.dirp = f.dirp;
+		pipe_[0U]->stmt(f.s, f.z, &scn);
+	}
+	if (UNLIKELY(lastp && sp < ep)) {
+		errno = 0, error("Warning: input ends inside a frame");
+	}
+	return sp - buf;
+}
+
+static int
+fuse1(const char *fn)
+{
+	static char _buf[4096U];
+	char *buf = _buf;
+	size_t bsz = sizeof(_buf);
+	size_t bix;
+	int rc = 0;
+	int fd;
+
+	if (fn == NULL) {
+		fd = STDIN_FILENO;
+	} else if ((fd = open(fn, O_RDONLY)) < 0) {
+		error("Error: cannot open file `%s'", fn);
+		return -1;
+	}
+	/* read into buf */
+	bix = 0U;
+	frmi = -1;
+	for (ssize_t nrd, npr;
+	     (nrd = read(fd, buf + bix, bsz - bix - 1U/*\nul*/)) > 0;) {
+		/* mark the end of the buffer */
+		buf[bix += nrd] = '\0';
+		if (UNLIKELY(frmi < 0) && (frmi = frame_magicp(buf, bix)) < 0) {
+			/* can't tell yet whether it's framed */
+			continue;
+		} else if ((npr = (frmi ? proc_frm : proc)(buf, bix, false)) < 0) {
+			rc = -1;
+			goto fuck;
+		} else if (npr == 0 && bix + 1 >= bsz) {
+			/* need a bigger buffer */
+			RESZ(buf, bsz, bsz << 1U)
+			else {
+				rc = -1;
+				goto fuck;
+			}
+		} else if (npr == 0) {
+			/* just read some more */
+			;
+		} else if ((bix -= npr) > 0) {
+			/* memmove to the front */
+			memmove(buf, buf + npr, bix);
+		}
+	}
+	/* finalise buffer again, just in case */
+	buf[bix] = '\0';
+	/* last try, we don't care how much gets processed */
+	(void)(frmi > 0 ? proc_frm : proc)(buf, bix, true);
+
+fuck:
+	/* finalise processing */
+	fini_proc();
+	close(fd);
+	if (buf != _buf) {
+		munmap(buf, bsz);
+	}
+	return rc;
+}
+
+
+static const char usage[] = "\
+Usage: rdfsnips STAGE [OPTION]... [FILE]... [: STAGE [OPTION]... [FILE]...]...\n\
+   or: rdfsnips TOOL [OPTION]... [ARG]...\n\
+\n\
+Scan FILEs, or stdin, once and pass every statement through the\n\
+pipeline of STAGEs separated by `:', each stage taking the options\n\
+of its standalone tool.  The FILEs may be given to any one stage.\n\
+\n\
+Without a `:' run TOOL as if it had been invoked directly, the same\n\
+happens when invoked through a link named after the tool.\n\
+\n\
+Stages and tools:\n\
+  prefixify   ttl-prefixify, substitute prefixes in statements\n\
+                and hand them on\n\
+  split       ttl-split, write statements to chunk files\n\
+  wc          ttl-wc, count subjects, predicates and statements\n\
+  hashl       hashl, print the hash of every statement\n\
+\n\
+Stages see statements, not lines, so the hashl stage prints one hash\n\
+per statement where the hashl tool prints one per line.  The two agree\n\
+on one statement per line, as in N-Triples, but not on the @prefix\n\
+header, blank lines or multi-line statements in, say, the output of\n\
+ttl-prefixify, which the stage never sees as lines.\n\
+\n\
+Each stage may appear at most once, the counts of wc are printed\n\
+after the output of later stages.\n\
+\n\
+  -h, --help            display this help and exit\n\
+  -V, --version         output version information and exit\n\
+";
+
+int
+main(int argc, char *argv[])
+{
+	const struct stage_s *s;
+	const char *me;
+	char **args = NULL;
+	int nargs = 0;
+	bool pipep = false;
+	int rc = 0;
+
+	/* multi-call binary? */
+	me = (me = strrchr(argv[0], '/')) ? me + 1U : argv[0];
+	if ((s = find_stage(me)) != NULL && !strcmp(me, s->tool)) {
+		return s->main(argc, argv);
+	} else if (argc < 2) {
+		fputs(usage, stderr);
+		return 1;
+	} else if (!strcmp(argv[1], "-h") || !strcmp(argv[1], "--help")) {
+		fputs(usage, stdout);
+		return 0;
+	} else if (!strcmp(argv[1], "-V") || !strcmp(argv[1], "--version")) {
+#if defined PACKAGE_VERSION
+		puts("rdfsnips " PACKAGE_VERSION);
+#else  /* !PACKAGE_VERSION */
+		puts("rdfsnips unknown version");
+#endif	/* PACKAGE_VERSION */
+		return 0;
+	}
+	for (int i = 1; i < argc; i++) {
+		pipep |= !strcmp(argv[i], ":");
+	}
+	if (!pipep) {
+		if ((s = find_stage(argv[1])) == NULL) {
+			errno = 0, error("Error: no such tool `%s'", argv[1]);
+			return 1;
+		}
+		return s->main(argc - 1, argv + 1);
+	}
+
+	/* set up the pipeline, back to front so stages know their sinks */
+	for (int i = argc, j; i > 1; i = j) {
+		stage_stmt_f nxt = npipe ? pipe_[npipe - 1U]->stmt : NULL;
+		char **sa;
+		int n;
+
+		for (j = i; j > 1 && strcmp(argv[j - 1], ":"); j--);
+		if (j >= i || (s = find_stage(argv[j])) == NULL) {
+			errno = 0, error("\
+Error: no such stage `%s'", j < i ? argv[j] : ":");
+			return 1;
+		}
+		for (size_t k = 0U; k < npipe; k++) {
+			if (pipe_[k] == s) {
+				errno = 0, error("\
+Error: stage `%s' can only be used once", s->name);
+				return 1;
+			}
+		}
+		/* the stage sees its bit of the command line, argv[i]
+		 * is either the `:' of the next stage or the final NULL */
+		argv[i] = NULL;
+		if ((n = s->init(i - j, argv + j, nxt, &sa)) < 0) {
+			return 1;
+		}
+		pipe_[npipe++] = s;
+		if (n > 0 && nargs > 0) {
+			errno = 0, error("\
+Error: FILEs can only be given to one stage");
+			return 1;
+		} else if (n > 0) {
+			args = sa;
+			nargs = n;
+		}
+		/* the colon before us */
+		j -= j > 1;
+	}
+	/* stages were set up back to front */
+	for (size_t i = 0U, k = npipe - 1U; i < k; i++, k--) {
+		s = pipe_[i];
+		pipe_[i] = pipe_[k];
+		pipe_[k] = s;
+	}
+
+	if (nargs == 0) {
+		rc -= fuse1(NULL);
+	}
+	for (int i = 0; i < nargs; i++) {
+		rc -= fuse1(args[i]);
+	}
+
+	/* finalise back to front so that what the later stages still
+	 * have to write comes before the summaries of earlier ones */
+	for (size_t i = npipe; i > 0U; i--) {
+		rc |= pipe_[i - 1U]->fini();
+		fflush(stdout);
+	}
+	return rc;
+}
+
+/* rdfsnips.c ends here */
@@ -0,0 +1,470 @@
+/*** scan-gen.c -- generate the turtle scanner tables
+ *
+ * Copyright (C) 2026 Sebastian Freundt
+ *
+ * Author:  Sebastian Freundt <freundt@ga-group.nl>
+ *
+ * This file is part of rdfsnips.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the author nor the names of any contributors
+ *    may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED.  IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ ***/
+#include <stdio.h>
+
+/* Byte classes and states of the statement scanner in scan.c,
+ * this program prints the class table and the transition table
+ * as C source, scan-dfa.h, which scan.c includes.
+ *
+ * A transition is the next state in the lower 8 bits and a set of
+ * actions in the upper 8 bits, see below. */
+
+enum {
+	C_ETC,
+	C_WS,
+	C_NL,
+	C_DOT,
+	C_LT,
+	C_GT,
+	C_DQ,
+	C_SQ,
+	C_BSL,
+	C_HASH,
+	C_SEMI,
+	C_COMMA,
+	C_OPEN,
+	C_CLOSE,
+	C_DIGIT,
+	C_AT,
+	/* letters of PREFIX and BASE, either case */
+	C_P,
+	C_R,
+	C_E,
+	C_F,
+	C_I,
+	C_X,
+	C_B,
+	C_A,
+	C_S,
+	NCLASSES
+};
+
+#define STATES(X)							\
+	/* between statements, must be 0 */				\
+	X(SOS) X(SOS_CMT)						\
+	/* between terms */						\
+	X(FREE) X(CMT)							\
+	/* bare words, prefixed names, numbers, keywords */		\
+	X(WORD) X(WORD_ESC)						\
+	/* a dot that may or may not end the statement */		\
+	X(WORD_DOT) X(FREE_DOT)						\
+	X(IRI)								\
+	/* one and two opening quotes, short and long strings */	\
+	X(DQ1) X(DQ2) X(DQS) X(DQS_ESC)					\
+	X(DQL) X(DQL_ESC) X(DQL_Q1) X(DQL_Q2)				\
+	X(SQ1) X(SQ2) X(SQS) X(SQS_ESC)					\
+	X(SQL) X(SQL_ESC) X(SQL_Q1) X(SQL_Q2)				\
+	/* sparql style directives, they end in an IRI */		\
+	X(KW_P) X(KW_PR) X(KW_PRE) X(KW_PREF) X(KW_PREFI) X(KW_PREFIX)	\
+	X(KW_B) X(KW_BA) X(KW_BAS) X(KW_BASE)				\
+	X(SDIR) X(SDIR_IRI)
+
+#define X(x)	S_##x,
+enum {
+	STATES(X)
+	NSTATES
+};
+#undef X
+
+#define X(x)	#x,
+static const char *const snam[] = {
+	STATES(X)
+};
+#undef X
+
+/* row width of the emitted table */
+#define DFA_ROW	32U
+
+/* actions */
+#define A_BEG	0x0100U
+#define A_ENDP	0x0200U
+#define A_ENDH	0x0400U
+#define A_OPN	0x0800U
+#define A_CLS	0x1000U
+#define A_SEMI	0x2000U
+#define A_COMMA	0x4000U
+#define A_DIR	0x8000U
+/* target state is left by a single byte only, worth a memchr() */
+#define A_SKIP	0x10000U
+
+static unsigned int
+clsof(int c)
+{
+	switch (c) {
+	case '\n':
+		return C_NL;
+	case '\0' ... '\n' - 1:
+	case '\n' + 1 ... ' ':
+		return C_WS;
+	case '.':
+		return C_DOT;
+	case '<':
+		return C_LT;
+	case '>':
+		return C_GT;
+	case '"':
+		return C_DQ;
+	case '\'':
+		return C_SQ;
+	case '\\':
+		return C_BSL;
+	case '#':
+		return C_HASH;
+	case ';':
+		return C_SEMI;
+	case ',':
+		return C_COMMA;
+	case '[':
+	case '(':
+		return C_OPEN;
+	case ']':
+	case ')':
+		return C_CLOSE;
+	case '0' ... '9':
+		return C_DIGIT;
+	case '@':
+		return C_AT;
+	case 'P':
+	case 'p':
+		return C_P;
+	case 'R':
+	case 'r':
+		return C_R;
+	case 'E':
+	case 'e':
+		return C_E;
+	case 'F':
+	case 'f':
+		return C_F;
+	case 'I':
+	case 'i':
+		return C_I;
+	case 'X':
+	case 'x':
+		return C_X;
+	case 'B':
+	case 'b':
+		return C_B;
+	case 'A':
+	case 'a':
+		return C_A;
+	case 'S':
+	case 's':
+		return C_S;
+	default:
+		break;
+	}
+	return C_ETC;
+}
+
+static unsigned int
+free_like(unsigned int c)
+{
+/* between terms */
+	switch (c) {
+	case C_WS:
+	case C_NL:
+	case C_GT:
+		return S_FREE;
+	case C_DOT:
+		return S_FREE_DOT;
+	case C_LT:
+		return S_IRI;
+	case C_DQ:
+		return S_DQ1;
+	case C_SQ:
+		return S_SQ1;
+	case C_BSL:
+		return S_WORD_ESC;
+	case C_HASH:
+		return S_CMT;
+	case C_SEMI:
+		return S_FREE | A_SEMI;
+	case C_COMMA:
+		return S_FREE | A_COMMA;
+	case C_OPEN:
+		return S_FREE | A_OPN;
+	case C_CLOSE:
+		return S_FREE | A_CLS;
+	default:
+		break;
+	}
+	return S_WORD;
+}
+
+static unsigned int
+sos(unsigned int c)
+{
+/* between statements */
+	switch (c) {
+	case C_WS:
+	case C_NL:
+		return S_SOS;
+	case C_HASH:
+		return S_SOS_CMT;
+	case C_P:
+		return S_KW_P | A_BEG;
+	case C_B:
+		return S_KW_B | A_BEG;
+	case C_AT:
+		return S_WORD | A_BEG | A_DIR;
+	default:
+		break;
+	}
+	return free_like(c) | A_BEG;
+}
+
+static unsigned int
+word(unsigned int c)
+{
+	switch (c) {
+	case C_DOT:
+		return S_WORD_DOT;
+	case C_ETC:
+	case C_DIGIT:
+	case C_AT:
+	case C_P ... C_S:
+		return S_WORD;
+	default:
+		break;
+	}
+	return free_like(c);
+}
+
+static unsigned int
+kw(unsigned int c, unsigned int want, unsigned int next)
+{
+	if (c == want) {
+		return next;
+	}
+	return word(c);
+}
+
+static unsigned int
+kw_fin(unsigned int c)
+{
+	switch (c) {
+	case C_WS:
+	case C_NL:
+		return S_SDIR | A_DIR;
+	default:
+		break;
+	}
+	return word(c);
+}
+
+static unsigned int
+trans(unsigned int s, unsigned int c)
+{
+	switch (s) {
+	case S_SOS:
+		return sos(c);
+	case S_SOS_CMT:
+		return c == C_NL ? S_SOS : S_SOS_CMT;
+	case S_FREE:
+		return free_like(c);
+	case S_CMT:
+		return c == C_NL ? S_FREE : S_CMT;
+	case S_WORD:
+		return word(c);
+	case S_WORD_ESC:
+		return S_WORD;
+	case S_WORD_DOT:
+		/* dots inside names, a..b being legal */
+		switch (c) {
+		case C_ETC:
+		case C_DIGIT:
+		case C_AT:
+		case C_P ... C_S:
+			return S_WORD;
+		case C_DOT:
+			return S_WORD_DOT;
+		default:
+			break;
+		}
+		return sos(c) | A_ENDP;
+	case S_FREE_DOT:
+		/* decimals like .5 */
+		if (c == C_DIGIT) {
+			return S_WORD;
+		}
+		return sos(c) | A_ENDP;
+	case S_IRI:
+		return c == C_GT ? S_FREE : S_IRI;
+
+	case S_DQ1:
+		return c == C_DQ ? S_DQ2 : c == C_BSL ? S_DQS_ESC : S_DQS;
+	case S_DQ2:
+		/* either the empty string or a long one */
+		return c == C_DQ ? S_DQL : free_like(c);
+	case S_DQS:
+		return c == C_DQ ? S_FREE : c == C_BSL ? S_DQS_ESC : S_DQS;
+	case S_DQS_ESC:
+		return S_DQS;
+	case S_DQL:
+		return c == C_DQ ? S_DQL_Q1 : c == C_BSL ? S_DQL_ESC : S_DQL;
+	case S_DQL_ESC:
+		return S_DQL;
+	case S_DQL_Q1:
+		return c == C_DQ ? S_DQL_Q2 : c == C_BSL ? S_DQL_ESC : S_DQL;
+	case S_DQL_Q2:
+		return c == C_DQ ? S_FREE : c == C_BSL ? S_DQL_ESC : S_DQL;
+
+	case S_SQ1:
+		return c == C_SQ ? S_SQ2 : c == C_BSL ? S_SQS_ESC : S_SQS;
+	case S_SQ2:
+		return c == C_SQ ? S_SQL : free_like(c);
+	case S_SQS:
+		return c == C_SQ ? S_FREE : c == C_BSL ? S_SQS_ESC : S_SQS;
+	case S_SQS_ESC:
+		return S_SQS;
+	case S_SQL:
+		return c == C_SQ ? S_SQL_Q1 : c == C_BSL ? S_SQL_ESC : S_SQL;
+	case S_SQL_ESC:
+		return S_SQL;
+	case S_SQL_Q1:
+		return c == C_SQ ? S_SQL_Q2 : c == C_BSL ? S_SQL_ESC : S_SQL;
+	case S_SQL_Q2:
+		return c == C_SQ ? S_FREE : c == C_BSL ? S_SQL_ESC : S_SQL;
+
+	case S_KW_P:
+		return kw(c, C_R, S_KW_PR);
+	case S_KW_PR:
+		return kw(c, C_E, S_KW_PRE);
+	case S_KW_PRE:
+		return kw(c, C_F, S_KW_PREF);
+	case S_KW_PREF:
+		return kw(c, C_I, S_KW_PREFI);
+	case S_KW_PREFI:
+		return kw(c, C_X, S_KW_PREFIX);
+	case S_KW_B:
+		return kw(c, C_A, S_KW_BA);
+	case S_KW_BA:
+		return kw(c, C_S, S_KW_BAS);
+	case S_KW_BAS:
+		return kw(c, C_E, S_KW_BASE);
+	case S_KW_PREFIX:
+	case S_KW_BASE:
+		return kw_fin(c);
+	case S_SDIR:
+		return c == C_LT ? S_SDIR_IRI : S_SDIR;
+	case S_SDIR_IRI:
+		return c == C_GT ? S_SOS | A_ENDH : S_SDIR_IRI;
+	default:
+		break;
+	}
+	return S_SOS;
+}
+
+
+int
+main(void)
+{
+	char skip[NSTATES];
+
+	if (NCLASSES > DFA_ROW) {
+		fputs("Error: too many character classes\n", stderr);
+		return 1;
+	}
+	puts("/* generated by scan-gen, do not edit */");
+	/* states are offsets of their rows in the table, rows are padded
+	 * to a power of 2 so the lookup is a single add and load */
+	for (unsigned int s = 0U; s < NSTATES; s++) {
+		printf("#define S_%s\t%uU\n", snam[s], s * DFA_ROW);
+	}
+	printf("#define NSTATES\t%uU\n", NSTATES);
+	printf("#define NCLASSES\t%uU\n", NCLASSES);
+	printf("#define DFA_ROW\t%uU\n\n", DFA_ROW);
+
+	/* actions live above the state bits */
+	printf("#define S_MASK\t0x%08xU\n", 0xffffU);
+	printf("#define A_BEG\t0x%08xU\n", A_BEG << 8U);
+	printf("#define A_ENDP\t0x%08xU\n", A_ENDP << 8U);
+	printf("#define A_ENDH\t0x%08xU\n", A_ENDH << 8U);
+	printf("#define A_OPN\t0x%08xU\n", A_OPN << 8U);
+	printf("#define A_CLS\t0x%08xU\n", A_CLS << 8U);
+	printf("#define A_SEMI\t0x%08xU\n", A_SEMI << 8U);
+	printf("#define A_COMMA\t0x%08xU\n", A_COMMA << 8U);
+	printf("#define A_DIR\t0x%08xU\n", A_DIR << 8U);
+	printf("#define A_SKIP\t0x%08xU\n\n", A_SKIP << 8U);
+
+	puts("static const uint8_t ccls[256U] = {");
+	for (int c = 0; c < 256; c++) {
+		printf("%s%u,%s", c % 16 ? " " : "\t",
+		       clsof(c), c % 16 == 15 ? "\n" : "");
+	}
+	puts("};\n");
+
+	/* states with a single way out, the byte to look for */
+	puts("static const char skip[NSTATES] = {");
+	for (unsigned int s = 0U; s < NSTATES; s++) {
+		int x = -1;
+
+		for (int c = 0; c < 256; c++) {
+			if (trans(s, clsof(c)) == s) {
+				;
+			} else if (x < 0) {
+				x = c;
+			} else {
+				x = -1;
+				break;
+			}
+		}
+		skip[s] = (char)(x > 0 ? x : 0);
+		printf("\t/* S_%s */ %d,\n", snam[s], skip[s]);
+	}
+	puts("};\n");
+
+	puts("static const uint32_t dfa[NSTATES * DFA_ROW] = {");
+	for (unsigned int s = 0U; s < NSTATES; s++) {
+		printf("\t/* S_%s */\n\t", snam[s]);
+		for (unsigned int c = 0U; c < DFA_ROW; c++) {
+			unsigned int t = c < NCLASSES ? trans(s, c) : s;
+
+			if ((t & 0xffU) != s && skip[t & 0xffU]) {
+				t |= A_SKIP;
+			}
+			t = (t & 0xffU) * DFA_ROW | (t & ~0xffU) << 8U;
+			printf("0x%08x,%s", t,
+			       c == DFA_ROW - 1U ? "\n" : c % 6U == 5U ? "\n\t" : " ");
+		}
+	}
+	puts("};");
+	return 0;
+}
+
+/* scan-gen.c ends here */
@@ -0,0 +1,162 @@
+/*** scan.c -- turtle statement scanner
+ *
+ * Copyright (C) 2026 Sebastian Freundt
+ *
+ * Author:  Sebastian Freundt <freundt@ga-group.nl>
+ *
+ * This file is part of rdfsnips.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the author nor the names of any contributors
+ *    may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED.  IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ ***/
+#if defined HAVE_CONFIG_H
+# include "config.h"
+#endif	/* HAVE_CONFIG_H */
+#include <stdbool.h>
+#include <string.h>
+#include <stdint.h>
+#include "scan.h"
+#include "scan-dfa.h"
+#include "nifty.h"
+
+static inline const char*
+scan(struct scan_s *restrict x, const char **b,
+     const char *s, const char *e, bool lastp)
+{
+	unsigned int st = x->st;
+	const char *p = s + x->pos;
+	const char *eo;
+
+	/* if the statement's begun already it begins at S */
+	*b = st > S_SOS_CMT ? s : NULL;
+	for (; p < e; p++) {
+		const unsigned int c = ccls[(unsigned char)*p];
+		uint_fast32_t t = dfa[st + c];
+
+		st = t & S_MASK;
+		if (LIKELY(t <= S_MASK)) {
+			continue;
+		}
+	act:
+		if (t & A_ENDP) {
+			if (LIKELY(!x->dep)) {
+				/* the dot before ended it */
+				eo = p;
+				goto stmt;
+			}
+			/* just a dot in brackets, rescan as free text */
+			t = dfa[S_FREE + c];
+			st = t & S_MASK;
+			goto act;
+		}
+		if (t & A_BEG) {
+			*b = p;
+			x->dep = 0U;
+			x->nsemi = 0U;
+			x->ncomma = 0U;
+			x->dirp = 0U;
+		}
+		if (t & A_DIR) {
+			x->dirp = 1U;
+		}
+		if (t & A_OPN) {
+			x->dep++;
+		}
+		if (t & A_CLS) {
+			x->dep -= !!x->dep;
+		}
+		if (t & A_SEMI) {
+			x->nsemi += !x->dep;
+		}
+		if (t & A_COMMA) {
+			x->ncomma += !x->dep;
+		}
+		if (t & A_ENDH) {
+			eo = p + 1U;
+			goto stmt;
+		}
+		if (t & A_SKIP) {
+			/* only one byte gets us out of here, jump to it */
+			const char *q = memchr(p + 1U, skip[st / DFA_ROW], e - p - 1);
+			p = (q ?: e) - 1;
+		}
+	}
+	if (lastp && (st == S_WORD_DOT || st == S_FREE_DOT) && !x->dep) {
+		/* the input ends in a full stop */
+		eo = e;
+		goto stmt;
+	}
+	/* pending */
+	x->st = st;
+	if (*b == NULL) {
+		/* only blanks and comments */
+		*b = e;
+	}
+	x->pos = e - *b;
+	return NULL;
+
+stmt:
+	x->st = S_SOS;
+	x->pos = 0U;
+	return eo;
+}
+
+const char*
+scan_stmt(struct scan_s *restrict x, const char **b,
+	  const char *s, const char *e)
+{
+	return scan(x, b, s, e, false);
+}
+
+const char*
+scan_last(struct scan_s *restrict x, const char **b,
+	  const char *s, const char *e)
+{
+	return scan(x, b, s, e, true);
+}
+
+size_t
+scan_dir(char *restrict buf, size_t bsz, const char *s, size_t z)
+{
+	/* keywords are PREFIX and BASE, in any case */
+	const size_t kz = (*s | 0x20) == 'p' ? 6U : 4U;
+	const char *kw = kz == 6U ? "@prefix" : "@base";
+	size_t n = kz + 1U;
+
+	if (UNLIKELY(n + z - kz + 2U > bsz)) {
+		return 0U;
+	}
+	memcpy(buf, kw, n);
+	memcpy(buf + n, s + kz, z - kz);
+	n += z - kz;
+	buf[n++] = ' ';
+	buf[n++] = '.';
+	return n;
+}
+
+/* scan.c ends here */
@@ -0,0 +1,88 @@
+/*** scan.h -- turtle statement scanner
+ *
+ * Copyright (C) 2026 Sebastian Freundt
+ *
+ * Author:  Sebastian Freundt <freundt@ga-group.nl>
+ *
+ * This file is part of rdfsnips.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the author nor the names of any contributors
+ *    may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED.  IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ ***/
+#if !defined INCLUDED_scan_h_
+#define INCLUDED_scan_h_
+#include <stddef.h>
+
+/* Statement scanner, a table driven DFA over byte classes that knows
+ * IRIs, all four string forms and their escapes, comments, decimals,
+ * bracket nesting and turtle as well as sparql style directives.
+ *
+ * The scanner is incremental, when there's no complete statement in
+ * the buffer the caller keeps the bytes from the beginning of the
+ * pending statement onwards, appends more input and calls again with
+ * S pointing to the kept bytes.  The scanner picks up where it left. */
+
+struct scan_s {
+	/* state and bracket depth after the bytes scanned so far */
+	unsigned int st;
+	unsigned int dep;
+	/* number of bytes of the pending statement already scanned */
+	size_t pos;
+
+	/* properties of the statement last returned, separators are
+	 * only counted outside brackets */
+	size_t nsemi;
+	size_t ncomma;
+	unsigned int dirp:1;
+};
+
+/**
+ * Find the next statement in [S, E), return a pointer past its end and
+ * set *B to its beginning, or return NULL and set *B to the beginning
+ * of the pending statement if there's no complete statement.
+ * Statements start at their first non-blank non-comment character.
+ * A full stop is only known to end a statement when the next byte
+ * has been seen, so the last statement of the input might need
+ * scan_last(). */
+extern const char*
+scan_stmt(struct scan_s *restrict x, const char **b,
+	  const char *s, const char *e);
+
+/**
+ * Like scan_stmt() but E is the end of the input. */
+extern const char*
+scan_last(struct scan_s *restrict x, const char **b,
+	  const char *s, const char *e);
+
+/**
+ * Rewrite sparql style directive [S, S + Z), i.e. PREFIX or BASE, into
+ * its turtle equivalent in BUF of size BSZ.  Return the new length,
+ * or 0 if it doesn't fit. */
+extern size_t scan_dir(char *restrict buf, size_t bsz, const char *s, size_t z);
+
+#endif	/* INCLUDED_scan_h_ */
@@ -0,0 +1,75 @@
+/*** stage.h -- stages of fused pipelines
+ *
+ * Copyright (C) 2026 Sebastian Freundt
+ *
+ * Author:  Sebastian Freundt <freundt@ga-group.nl>
+ *
+ * This file is part of rdfsnips.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the author nor the names of any contributors
+ *    may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED.  IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ ***/
+#if !defined INCLUDED_stage_h_
+#define INCLUDED_stage_h_
+#include <stddef.h>
+#include "scan.h"
+
+/* The tools built into the multi-call rdfsnips binary (compiled with
+ * RDFSNIPS defined) double as stages of a fused pipeline.  The driver
+ * scans the input once and hands every statement to the first stage,
+ * each stage does its thing and hands the statement, possibly altered,
+ * on to the next one.  Stages may appear only once per pipeline as
+ * they keep their state in file scope like the tools do. */
+
+/**
+ * Statement callback, S of length Z is a statement as delivered by the
+ * scanner, i.e. up to and including the full stop, directives in their
+ * @prefix/@base form, X is the scanner state describing it. */
+typedef void(*stage_stmt_f)(const char *s, size_t z, const struct scan_s *x);
+
+struct stage_s {
+	/* name as used in pipelines and the name of the standalone tool */
+	const char *name;
+	const char *tool;
+	/* the tool's main() */
+	int(*main)(int argc, char *argv[]);
+	/* parse options in ARGV, statements are to be passed on to NXT,
+	 * which is NULL for the last stage, return the number of non-option
+	 * arguments, to be put in *ARGS, or -1 on error */
+	int(*init)(int argc, char *argv[], stage_stmt_f nxt, char ***args);
+	stage_stmt_f stmt;
+	/* flush and return exit code */
+	int(*fini)(void);
+};
+
+extern const struct stage_s stage_ttl_prefixify;
+extern const struct stage_s stage_ttl_split;
+extern const struct stage_s stage_ttl_wc;
+extern const struct stage_s stage_hashl;
+
+#endif	/* INCLUDED_stage_h_ */
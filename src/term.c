@@ -0,0 +1,249 @@
+/*** term.c -- turtle term boundaries
+ *
+ * Copyright (C) 2026 Sebastian Freundt
+ *
+ * Author:  Sebastian Freundt <freundt@ga-group.nl>
+ *
+ * This file is part of rdfsnips.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the author nor the names of any contributors
+ *    may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED.  IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ ***/
+#if defined HAVE_CONFIG_H
+# include "config.h"
+#endif	/* HAVE_CONFIG_H */
+#include <stdbool.h>
+#include <string.h>
+#include "term.h"
+#include "nifty.h"
+
+static inline bool
+wordp(char c)
+{
+/* characters that can't end a bare word (prefixed names, numbers, etc.) */
+	switch (c) {
+	case '\0' ... ' ':
+	case '<':
+	case '>':
+	case '"':
+	case '\'':
+	case ';':
+	case ',':
+	case '(':
+	case ')':
+	case '[':
+	case ']':
+	case '#':
+		return false;
+	default:
+		return true;
+	}
+}
+
+static const char*
+lit_end(const char *s, const char *e)
+{
+/* S points to the opening quote */
+	const char q = *s;
+
+	if (s + 2 < e && s[1U] == q && s[2U] == q) {
+		/* long literal */
+		for (s += 3U; s < e; s++) {
+			if (*s == '\\') {
+				s++;
+			} else if (*s == q && s + 2 < e &&
+				   s[1U] == q && s[2U] == q) {
+				return s + 3U;
+			}
+		}
+		return e;
+	}
+	for (s++; s < e; s++) {
+		if (*s == '\\') {
+			s++;
+		} else if (*s == q) {
+			return s + 1U;
+		}
+	}
+	return e;
+}
+
+static const char*
+word_end(const char *s, const char *e)
+{
+	for (; s < e && wordp(*s); s++) {
+		if (*s == '\\') {
+			/* escaped local name characters */
+			s++;
+		} else if (*s == '.' &&
+			   (s + 1 >= e || !wordp(s[1U]) || s[1U] == '.')) {
+			/* trailing dots aren't part of names */
+			break;
+		}
+	}
+	return s < e ? s : e;
+}
+
+
+const char*
+term_skip(const char *s, const char *e)
+{
+	while (s < e) {
+		if ((unsigned char)*s <= ' ') {
+			s++;
+		} else if (*s == '#') {
+			const char *eol = memchr(s, '\n', e - s);
+			s = eol ? eol + 1U : e;
+		} else {
+			break;
+		}
+	}
+	return s;
+}
+
+const char*
+term_end(const char *s, const char *e)
+{
+	if (UNLIKELY(s >= e)) {
+		return e;
+	}
+	switch (*s) {
+	case '<':
+		if ((s = memchr(s, '>', e - s)) == NULL) {
+			return e;
+		}
+		return s + 1U;
+	case '"':
+	case '\'':
+		s = lit_end(s, e);
+		if (s < e && *s == '@') {
+			/* language tag */
+			return word_end(s + 1U, e);
+		} else if (s + 1 < e && s[0U] == '^' && s[1U] == '^') {
+			/* datatype */
+			return term_end(s + 2U, e);
+		}
+		return s;
+	case '[':
+	case '(':;
+		const char c = *s == '[' ? ']' : ')';
+
+		for (s = term_skip(s + 1U, e); s < e && *s != c;) {
+			if (*s == ';' || *s == ',') {
+				s = term_skip(s + 1U, e);
+			} else {
+				const char *x = term_end(s, e);
+				/* make sure we move on */
+				s = term_skip(x > s ? x : s + 1U, e);
+			}
+		}
+		return s < e ? s + 1U : e;
+	default:
+		return word_end(s, e);
+	}
+}
+
+const char*
+term_stmt_end(const char *s, const char *e)
+{
+	if ((s = term_skip(s, e)) >= e) {
+		return NULL;
+	} else if (*s == '@') {
+		/* directives end in a dot too, just skip the keyword */
+		s = word_end(s + 1U, e);
+	}
+	for (const char *x; (s = term_skip(s, e)) < e; s = x) {
+		switch (*s) {
+		case '.':
+			return s + 1U;
+		case ';':
+		case ',':
+			x = s + 1U;
+			break;
+		default:
+			if ((x = term_end(s, e)) <= s || x >= e) {
+				return NULL;
+			}
+			break;
+		}
+	}
+	return NULL;
+}
+
+const char*
+term_resync(const char *s, const char *e, size_t nchk)
+{
+	for (const char *dp; s < e && (dp = memchr(s, '.', e - s)); s = dp + 1U) {
+		const char *bo = dp + 1U;
+		const char *tp = bo;
+
+		/* rest of the line must be blank */
+		for (; tp < e && (*tp == ' ' || *tp == '\t' || *tp == '\r'); tp++);
+		if (tp >= e || *tp != '\n') {
+			continue;
+		}
+		/* next non-blank line starts in column 1 with something
+		 * sensible */
+		for (const char *lp = ++tp; lp < e; lp++) {
+			if (*lp == '\n') {
+				tp = lp + 1U;
+			} else if (*lp != ' ' && *lp != '\t' && *lp != '\r') {
+				break;
+			}
+		}
+		if (tp >= e) {
+			continue;
+		}
+		switch (*tp) {
+		case '\0' ... ' ':
+		case '.':
+		case ';':
+		case ',':
+		case ']':
+		case ')':
+		case '"':
+		case '\'':
+			continue;
+		default:
+			break;
+		}
+		/* check that NCHK statements follow */
+		tp = bo;
+		with (size_t i = 0U) {
+			for (const char *x; i < nchk &&
+				     (x = term_stmt_end(tp, e)) != NULL; tp = x, i++);
+			if (i >= nchk || i && term_skip(tp, e) >= e) {
+				/* either all good or we ran out of input */
+				return bo;
+			}
+		}
+	}
+	return NULL;
+}
+
+/* term.c ends here */
@@ -0,0 +1,69 @@
+/*** term.h -- turtle term boundaries
+ *
+ * Copyright (C) 2026 Sebastian Freundt
+ *
+ * Author:  Sebastian Freundt <freundt@ga-group.nl>
+ *
+ * This file is part of rdfsnips.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the author nor the names of any contributors
+ *    may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED.  IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ ***/
+#if !defined INCLUDED_term_h_
+#define INCLUDED_term_h_
+#include <stddef.h>
+
+/* Routines to find the boundaries of turtle terms inside a statement
+ * as delivered by the scanners, i.e. the statement is complete and
+ * comments have been left in place. */
+
+/**
+ * Return pointer to the first character in [S, E) that is neither
+ * whitespace nor part of a comment. */
+extern const char *term_skip(const char *s, const char *e);
+
+/**
+ * Return pointer past the term starting at S, with E marking the end
+ * of the statement.  Terms are IRIs, literals including their language
+ * tag or datatype, prefixed names, blank nodes, numbers, keywords,
+ * and bracketed [ ] or ( ) constructs as a whole. */
+extern const char *term_end(const char *s, const char *e);
+
+/**
+ * Return pointer past the full stop of the statement starting at S,
+ * or NULL if there's no statement end before E. */
+extern const char *term_stmt_end(const char *s, const char *e);
+
+/**
+ * Find a statement boundary at or after S, looking no further than E.
+ * Candidates are full stops at the end of a line whose following line
+ * begins in the first column, they're accepted if NCHK statements can
+ * be read off after them.  Return NULL if there's no such boundary. */
+extern const char *term_resync(const char *s, const char *e, size_t nchk);
+
+#endif	/* INCLUDED_term_h_ */
@@ -0,0 +1,537 @@
+/*** ttl-compact.c -- fold statements about the same subject
+ *
+ * Copyright (C) 2026 Sebastian Freundt
+ *
+ * Author:  Sebastian Freundt <freundt@ga-group.nl>
+ *
+ * This file is part of rdfsnips.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the author nor the names of any contributors
+ *    may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED.  IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ ***/
+#if defined HAVE_CONFIG_H
+# include "config.h"
+#endif	/* HAVE_CONFIG_H */
+#include <stdlib.h>
+#include <unistd.h>
+#include <stdbool.h>
+#include <sys/mman.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdarg.h>
+#include <fcntl.h>
+#include <errno.h>
+#include "scan.h"
+#include "term.h"
+#include "frame.h"
+#include "obuf.h"
+#include "nifty.h"
+
+#if !defined MAP_ANON && defined MAP_ANONYMOUS
+# define MAP_ANON	MAP_ANONYMOUS
+#elif !defined MAP_ANON
+# define MAP_ANON	(0x1000U)
+#endif	/* !MAP_ANON */
+#define PROT_RW		(PROT_READ | PROT_WRITE)
+#define MAP_MEM		(MAP_PRIVATE | MAP_ANON)
+
+/* a predicate of the current group and its chain of objects,
+ * offsets are into the group's text buffer */
+struct pred_s {
+	size_t p, pz;
+	/* first and last object */
+	size_t o1, on;
+};
+
+struct obj_s {
+	size_t o, oz;
+	/* index of the next object plus 1, or 0 */
+	size_t nx;
+};
+
+/* a statement split into predicate-object pairs, pointers are into
+ * the scan buffer */
+struct po_s {
+	const char *p;
+	size_t pz;
+	const char *o;
+	size_t oz;
+};
+
+/* scanner state */
+static struct scan_s scn;
+
+/* whether the input is framed, -1 for don't know yet,
+ * 1 if there's still the magic to skip */
+static int frmi;
+
+/* maximum number of objects to fold into one statement */
+static size_t wndw = 1024U;
+
+/* the current group, subject at the beginning of the text buffer */
+static char *gtxt;
+static size_t gtxtz;
+static size_t gtxti;
+static size_t gsubz;
+static struct pred_s *gprd;
+static size_t gprdz;
+static size_t nprd;
+static struct obj_s *gobj;
+static size_t gobjz;
+static size_t nobj;
+
+/* the statement currently being looked at */
+static struct po_s *pos;
+static size_t posz;
+static size_t npos;
+
+/* buffered stdout */
+static obuf_t sob;
+
+
+/* helpers */
+static void
+__attribute__((format(printf, 1, 2)))
+error(const char *fmt, ...)
+{
+	va_list vap;
+	va_start(vap, fmt);
+	vfprintf(stderr, fmt, vap);
+	va_end(vap);
+	if (errno) {
+		fputc(':', stderr);
+		fputc(' ', stderr);
+		fputs(strerror(errno), stderr);
+	}
+	fputc('\n', stderr);
+	return;
+}
+
+static void*
+resz(void *buf, size_t old, size_t new)
+{
+	void *nub = mmap(NULL, new, PROT_RW, MAP_MEM, -1, 0);
+
+	if (UNLIKELY(nub == MAP_FAILED)) {
+		return NULL;
+	}
+	(void)memcpy(nub, buf, old);
+	return nub;
+}
+
+#define RESZ(_b, _oz, _nz)						\
+	size_t _nuz_ = _nz;						\
+	void *_nub_ = resz(_b, _oz, _nuz_);				\
+	if (LIKELY(_nub_ != NULL)) {					\
+		_b = _nub_;						\
+		_oz = _nuz_;						\
+	}
+
+static void*
+grow(void *p, size_t *nz, size_t n, size_t elz)
+{
+/* make room for N elements of size ELZ in P, currently of *NZ elements */
+	if (UNLIKELY(n > *nz)) {
+		size_t nu = *nz ? *nz : 64U;
+
+		while (nu < n) {
+			nu <<= 1U;
+		}
+		if ((p = realloc(p, nu * elz)) != NULL) {
+			*nz = nu;
+		}
+	}
+	return p;
+}
+
+
+/* output */
+static inline void
+out(const char *s, size_t z)
+{
+	(void)obuf_write(sob, s, z);
+	return;
+}
+
+static void
+out_stmt(const char *s, size_t z, bool dirp)
+{
+/* write statement S of length Z like ttl-prefixify does */
+	if (!dirp) {
+		out("\n", 1U);
+	}
+	out(s, z);
+	out("\n", 1U);
+	return;
+}
+
+
+/* grouping */
+static int
+split_stmt(const char *s, size_t z)
+{
+/* split statement S of length Z into predicate-object pairs, the
+ * subject goes to slot 0, return the number of pairs or -1 if the
+ * statement can't be folded */
+	const char *const e = s + z;
+	const char *sp = term_skip(s, e);
+	const char *x;
+
+	npos = 0U;
+	if (UNLIKELY(sp >= e) || *sp == '[' || *sp == '(') {
+		/* blank node property lists and collections are
+		 * a new node each, they can't be merged */
+		return -1;
+	} else if ((x = term_end(sp, e)) <= sp) {
+		return -1;
+	}
+	if ((pos = grow(pos, &posz, 1U, sizeof(*pos))) == NULL) {
+		return -1;
+	}
+	pos[npos++] = (struct po_s){sp, x - sp, NULL, 0U};
+
+	for (sp = term_skip(x, e); sp < e && *sp != '.';) {
+		const char *p = sp;
+		const char *pe = term_end(p, e);
+
+		if (pe <= p) {
+			return -1;
+		}
+		sp = term_skip(pe, e);
+		do {
+			const char *o = sp;
+			const char *oe = term_end(o, e);
+
+			if (oe <= o) {
+				return -1;
+			} else if ((pos = grow(pos, &posz, npos + 1U,
+					       sizeof(*pos))) == NULL) {
+				return -1;
+			}
+			pos[npos++] = (struct po_s){p, pe - p, o, oe - o};
+			sp = term_skip(oe, e);
+		} while (sp < e && *sp == ',' && (sp = term_skip(sp + 1U, e)));
+
+		if (sp < e && *sp == ';') {
+			/* allow for empty predicate-object lists */
+			do {
+				sp = term_skip(sp + 1U, e);
+			} while (sp < e && *sp == ';');
+		} else if (sp >= e || *sp != '.') {
+			return -1;
+		}
+	}
+	if (sp >= e || npos <= 1U) {
+		/* no full stop or no predicates */
+		return -1;
+	}
+	return npos - 1U;
+}
+
+static size_t
+gput(const char *s, size_t z)
+{
+/* append S of length Z to the group text, return its offset */
+	size_t r = gtxti;
+
+	if (UNLIKELY(gtxti + z > gtxtz)) {
+		size_t nu = gtxtz ? gtxtz : 4096U;
+
+		while (nu < gtxti + z) {
+			nu <<= 1U;
+		}
+		if ((gtxt = realloc(gtxt, nu)) == NULL) {
+			gtxti = gtxtz = 0U;
+			return 0U;
+		}
+		gtxtz = nu;
+	}
+	memcpy(gtxt + gtxti, s, z);
+	gtxti += z;
+	return r;
+}
+
+static void
+grp_flush(void)
+{
+/* write the current group as one statement */
+	if (!nprd) {
+		return;
+	}
+	out("\n", 1U);
+	out(gtxt, gsubz);
+	for (size_t i = 0U; i < nprd; i++) {
+		if (i) {
+			out(" ;\n\t", 4U);
+		} else {
+			out(" ", 1U);
+		}
+		out(gtxt + gprd[i].p, gprd[i].pz);
+		out(" ", 1U);
+		for (size_t j = gprd[i].o1; j; j = gobj[j - 1U].nx) {
+			out(gtxt + gobj[j - 1U].o, gobj[j - 1U].oz);
+			if (gobj[j - 1U].nx) {
+				out(", ", 2U);
+			}
+		}
+	}
+	out(" .\n", 3U);
+	gtxti = gsubz = 0U;
+	nprd = nobj = 0U;
+	return;
+}
+
+static int
+grp_add(void)
+{
+/* fold the statement in POS into the current group */
+	const struct po_s *sub = pos;
+
+	if (nprd && (sub->pz != gsubz || memcmp(sub->p, gtxt, gsubz) ||
+		     nobj + npos - 1U > wndw)) {
+		/* new subject or group's full */
+		grp_flush();
+	}
+	if (!nprd) {
+		gput(sub->p, sub->pz);
+		gsubz = sub->pz;
+	}
+	if ((gobj = grow(gobj, &gobjz, nobj + npos, sizeof(*gobj))) == NULL ||
+	    (gprd = grow(gprd, &gprdz, nprd + npos, sizeof(*gprd))) == NULL) {
+		return -1;
+	}
+	for (size_t i = 1U, k; i < npos; i++) {
+		const struct po_s *po = pos + i;
+
+		/* find the predicate in the group, most likely
+		 * it's the last one or one we've just seen */
+		for (k = nprd; k > 0U; k--) {
+			const struct pred_s *p = gprd + k - 1U;
+
+			if (p->pz == po->pz &&
+			    !memcmp(gtxt + p->p, po->p, po->pz)) {
+				break;
+			}
+		}
+		if (!k) {
+			size_t pp = gput(po->p, po->pz);
+
+			gprd[nprd++] = (struct pred_s){pp, po->pz, 0U, 0U};
+			k = nprd;
+		}
+		/* chain up the object */
+		with (struct pred_s *p = gprd + k - 1U) {
+			size_t oo = gput(po->o, po->oz);
+
+			gobj[nobj++] = (struct obj_s){oo, po->oz, 0U};
+			if (p->on) {
+				gobj[p->on - 1U].nx = nobj;
+			} else {
+				p->o1 = nobj;
+			}
+			p->on = nobj;
+		}
+	}
+	if (UNLIKELY(gtxt == NULL)) {
+		nprd = nobj = 0U;
+		return -1;
+	}
+	return 0;
+}
+
+static void
+compact1(const char *s, size_t z, bool dirp)
+{
+	if (!dirp && split_stmt(s, z) > 0 && grp_add() >= 0) {
+		/* folded */
+		return;
+	}
+	/* keep the order of things */
+	grp_flush();
+	out_stmt(s, z, dirp);
+	return;
+}
+
+static ssize_t
+proc(const char *buf, size_t bsz, bool lastp)
+{
+	const char *sp = buf;
+	const char *const ep = buf + bsz;
+	const char *bo;
+
+	for (const char *eo;
+	     (eo = (lastp ? scan_last : scan_stmt)(&scn, &bo, sp, ep)) != NULL;
+	     sp = eo) {
+		compact1(bo, eo - bo, scn.dirp);
+	}
+	return bo - buf;
+}
+
+static ssize_t
+proc_frm(const char *buf, size_t bsz, bool lastp)
+{
+/* like proc() but for framed input */
+	const char *sp = buf;
+	const char *const ep = buf + bsz;
+	struct frame_s f;
+
+	if (UNLIKELY(frmi == 1)) {
+		sp += FRAME_MAGIC_LEN;
+		frmi = 2;
+	}
+	for (const char *eo; (eo = frame_get(&f, sp, ep)) != NULL; sp = eo) {
+		compact1(f.s, f.z, f.dirp);
+	}
+	if (UNLIKELY(lastp && sp < ep)) {
+		errno = 0, error("Warning: input ends inside a frame");
+	}
+	return sp - buf;
+}
+
+static int
+compact_fd(int fd)
+{
+	static char _buf[65536U];
+	char *buf = _buf;
+	size_t bsz = sizeof(_buf);
+	size_t bix;
+	int rc = 0;
+
+	/* read into buf */
+	bix = 0U;
+	frmi = -1;
+	memset(&scn, 0, sizeof(scn));
+	for (ssize_t nrd, npr;
+	     (nrd = read(fd, buf + bix, bsz - bix - 1U/*\nul*/)) > 0;) {
+		/* mark the end of the buffer */
+		buf[bix += nrd] = '\0';
+		if (UNLIKELY(frmi < 0) && (frmi = frame_magicp(buf, bix)) < 0) {
+			/* can't tell yet whether it's framed */
+			continue;
+		}
+		if ((npr = (frmi ? proc_frm : proc)(buf, bix, false)) < 0) {
+			rc = -1;
+			goto fuck;
+		} else if (npr == 0 && bix + 1 >= bsz) {
+			/* need a bigger buffer */
+			RESZ(buf, bsz, bsz << 1U)
+			else {
+				rc = -1;
+				goto fuck;
+			}
+		} else if (npr == 0) {
+			/* just read some more */
+			;
+		} else if ((bix -= npr) > 0) {
+			/* memmove to the front */
+			memmove(buf, buf + npr, bix);
+		}
+	}
+	/* finalise buffer again, just in case */
+	buf[bix] = '\0';
+	/* last try, we don't care how much gets processed */
+	(void)(frmi > 0 ? proc_frm : proc)(buf, bix, true);
+
+fuck:
+	/* groups don't span files */
+	grp_flush();
+	if (buf != _buf) {
+		munmap(buf, bsz);
+	}
+	return rc;
+}
+
+static int
+compact1_fn(const char *fn)
+{
+	int fd;
+	int rc;
+
+	if (fn == NULL) {
+		fd = STDIN_FILENO;
+	} else if ((fd = open(fn, O_RDONLY)) < 0) {
+		error("Error: cannot open file `%s'", fn);
+		return -1;
+	}
+	rc = compact_fd(fd);
+	close(fd);
+	return rc;
+}
+
+
+#include "ttl-compact.yucc"
+
+int
+main(int argc, char *argv[])
+{
+	yuck_t argi[1U];
+	int rc = 0;
+
+	if (yuck_parse(argi, argc, argv) < 0) {
+		rc = 1;
+		goto out;
+	}
+
+	if (argi->window_arg) {
+		char *on;
+		long unsigned int w = strtoul(argi->window_arg, &on, 0);
+
+		if (*on || !w) {
+			errno = 0, error("\
+Error: window must be a positive number");
+			rc = 1;
+			goto out;
+		}
+		wndw = w;
+	}
+	if (UNLIKELY((sob = make_obuf(STDOUT_FILENO, 0U, OBUF_ASYNC)) == NULL)) {
+		error("Error: cannot set up output buffer");
+		rc = 1;
+		goto out;
+	}
+
+	if (!argi->nargs) {
+		rc = compact1_fn(NULL) < 0;
+	}
+	for (size_t i = 0U; i < argi->nargs; i++) {
+		rc |= compact1_fn(argi->args[i]) < 0;
+	}
+	rc |= free_obuf(sob) < 0;
+
+	/* resource freeing */
+	free(gtxt);
+	free(gprd);
+	free(gobj);
+	free(pos);
+
+out:
+	yuck_free(argi);
+	return rc;
+}
+
+/* ttl-compact.c ends here */
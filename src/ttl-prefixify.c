@@ -38,13 +38,28 @@
 # include "config.h"
 #endif	/* HAVE_CONFIG_H */
 #include <unistd.h>
+#include <stdlib.h>
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
 #include <sys/mman.h>
+#include <sys/stat.h>
 #include <stdio.h>
 #include <string.h>
 #include <fcntl.h>
 #include <ctype.h>
+#include <stdarg.h>
+#include <errno.h>
+#include <pthread.h>
+#include "scan.h"
+#include "range.h"
+#include "frame.h"
+#include "pfxdict.h"
+#include "pool.h"
+#include "obuf.h"
+#if defined RDFSNIPS
+# include "stage.h"
+#endif	/* RDFSNIPS */
 #include "nifty.h"
 
 #if !defined MAP_ANON && defined MAP_ANONYMOUS
@@ -65,22 +80,114 @@ struct str_s {
 struct prfx_s {
 	struct str_s prfx;
 	struct str_s puri;
+	/* whether it's been substituted */
+	bool used;
 };
 
 #define LIT2STR(s)	{s, sizeof(s) - 1U}
 static struct prfx_s dflt_pres[64U] = {
-	{LIT2STR("foaf"), LIT2STR("http://xmlns.com/foaf/0.1/")},
-	{LIT2STR("ldp"), LIT2STR("http://www.w3.org/ns/ldp#")},
-	{LIT2STR("owl"), LIT2STR("http://www.w3.org/2002/07/owl#")},
-	{LIT2STR("rdf"), LIT2STR("http://www.w3.org/1999/02/22-rdf-syntax-ns#")},
+	{LIT2STR("foaf"), LIT2STR("http://xmlns.com/foaf/0.1/"), false},
+	{LIT2STR("ldp"), LIT2STR("http://www.w3.org/ns/ldp#"), false},
+	{LIT2STR("owl"), LIT2STR("http://www.w3.org/2002/07/owl#"), false},
+	{LIT2STR("rdf"), LIT2STR("http://www.w3.org/1999/02/22-rdf-syntax-ns#"), false},
 };
 
 static struct prfx_s *pres = dflt_pres;
 static size_t npres = 4U;
 static size_t zpres = countof(dflt_pres);
 
+/* radix trie over the namespaces in pres, for longest matches,
+ * nodes refer to their edge label as bytes of a namespace so
+ * moving pres around doesn't hurt */
+struct tnod_s {
+	/* label is LEN bytes of pres[PI].puri at offset OFF */
+	uint32_t pi;
+	uint32_t off;
+	uint32_t len;
+	/* first child and next sibling, 0 for none */
+	uint32_t kid;
+	uint32_t sib;
+	/* 1 + index into pres of the namespace ending here, or 0 */
+	uint32_t val;
+};
+
+static struct tnod_s *tri;
+static size_t ntri;
+static size_t ztri;
+/* number of pres indexed in the trie */
+static size_t ntpres;
+
+/* hash of prefix names, slots hold 1 + index into pres or 0 */
+static uint32_t *phtb;
+static size_t zphtb;
+/* number of pres in the hash */
+static size_t nhpres;
+
+/* namespace dictionaries to adopt prefixes from, --prefixes first */
+#include "pfx-builtin.h"
+static const void *dicts[2U];
+static size_t ndicts;
+/* the one from --prefixes, mapped or malloc()ed */
+static void *udict;
+static size_t udictz;
+static bool udmapp;
+
+/* scanner state */
+static struct scan_s scn;
+
+/* held back statements with --used-only */
+static FILE *spfp;
+
+/* where our output goes, and whether our prefixes are out yet,
+ * which happens once per output */
+static int cfd = STDOUT_FILENO;
+static bool hdrp;
+static bool magp;
+/* stdout is buffered separately */
+static obuf_t sob;
+
+/* with --in-place, the file mapped read-write, the read cursor, the
+ * write offset, and what doesn't fit behind the read cursor yet */
+static int ipfd = -1;
+static char *ipm;
+static size_t ipmz;
+static const char *iprd;
+static size_t ipwr;
+static char *ippnd;
+static size_t ipnpnd;
+static size_t ipzpnd;
+
+/* bytes to sample for prefix discovery, 0 for none */
+static size_t autoz;
+
+/* byte range to process, if requested */
+static struct range_s rng;
+static bool rngp;
+
+/* whether to write frames, and whether we're reading them,
+ * -1 for don't know yet, 1 if there's still the magic to skip */
+static bool frmo;
+static int frmi;
+
 
 /* helpers */
+static void
+__attribute__((format(printf, 1, 2)))
+error(const char *fmt, ...)
+{
+	va_list vap;
+	va_start(vap, fmt);
+	vfprintf(stderr, fmt, vap);
+	va_end(vap);
+	if (errno) {
+		fputc(':', stderr);
+		fputc(' ', stderr);
+		fputs(strerror(errno), stderr);
+	}
+	fputc('\n', stderr);
+	return;
+}
+
 static __attribute__((const, pure)) size_t
 next_2pow(size_t x)
 {
@@ -121,73 +228,505 @@ resz(void *buf, size_t old, size_t new)
 		_oz = _nuz_;						\
 	}
 
-static inline bool
-escapedp(const char *sp, const char *bp)
+
+/* namespace trie and prefix name hash */
+#define TLBL(n)		(pres[tri[n].pi].puri.str + tri[n].off)
+
+static int
+tri_new(void)
 {
-/* find out if sp is backslash-escaped
- * but backslash-escaped backslashes won't count,
- * so make sure the number of backslashes before sp is odd */
-	int bksl = 0;
+/* make room for another node, return -1 if there's none */
+	if (UNLIKELY(ntri >= ztri)) {
+		size_t nuz = ztri ? ztri << 1U : 256U;
+		struct tnod_s *nut;
 
-	while (sp-- > bp && *sp == '\\') {
-		bksl ^= 1;
+		nut = resz(tri, ntri * sizeof(*tri), nuz * sizeof(*tri));
+		if (UNLIKELY(nut == NULL)) {
+			return -1;
+		} else if (tri != NULL) {
+			munmap(tri, ztri * sizeof(*tri));
+		}
+		tri = nut;
+		ztri = nuz;
 	}
-	return bksl;
+	memset(tri + ntri, 0, sizeof(*tri));
+	return 0;
 }
 
-
+static int
+tri_add(size_t i)
+{
+/* index namespace of pres[I] */
+	const char *u = pres[i].puri.str;
+	const size_t uz = pres[i].puri.len;
+	size_t n = 0U;
+
+	if (UNLIKELY(!ntri)) {
+		/* root */
+		if (UNLIKELY(tri_new() < 0)) {
+			return -1;
+		}
+		ntri++;
+	}
+	for (size_t k = 0U, m, c; k < uz; n = c, k += m) {
+		for (c = tri[n].kid; c && *TLBL(c) != u[k]; c = tri[c].sib);
+		if (!c) {
+			/* new leaf */
+			if (UNLIKELY(tri_new() < 0)) {
+				return -1;
+			}
+			tri[ntri] = (struct tnod_s){
+				i, k, uz - k, 0U, tri[n].kid, i + 1U,
+			};
+			tri[n].kid = ntri++;
+			return 0;
+		}
+		/* find common bit */
+		with (const char *l = TLBL(c)) {
+			for (m = 1U; m < tri[c].len && k + m < uz &&
+				     l[m] == u[k + m]; m++);
+		}
+		if (m < tri[c].len) {
+			/* split C, the tail goes into a new node */
+			if (UNLIKELY(tri_new() < 0)) {
+				return -1;
+			}
+			tri[ntri] = (struct tnod_s){
+				tri[c].pi, tri[c].off + m, tri[c].len - m,
+				tri[c].kid, 0U, tri[c].val,
+			};
+			tri[c].len = m;
+			tri[c].kid = ntri++;
+			tri[c].val = 0U;
+		}
+	}
+	if (!tri[n].val) {
+		/* first one wins */
+		tri[n].val = i + 1U;
+	}
+	return 0;
+}
+
+static void
+tri_sync(void)
+{
+/* index what's new */
+	for (; ntpres < npres; ntpres++) {
+		(void)tri_add(ntpres);
+	}
+	return;
+}
+
+static size_t
+tri_get(const char *s)
+{
+/* return 1 + index into pres of the longest namespace that S starts
+ * with, or 0 if there's none, S is to be >- or \nul-terminated */
+	size_t best;
+
+	tri_sync();
+	if (UNLIKELY(!ntri)) {
+		return 0U;
+	}
+	best = tri[0U].val;
+	for (size_t n = 0U, c; (c = tri[n].kid); n = c) {
+		const char *l;
+		size_t m;
+
+		for (; c && *TLBL(c) != *s; c = tri[c].sib);
+		if (!c) {
+			break;
+		}
+		/* labels have neither > nor \nul so we stop in time */
+		for (l = TLBL(c), m = 1U; m < tri[c].len && l[m] == s[m]; m++);
+		if (m < tri[c].len) {
+			break;
+		}
+		s += m;
+		best = tri[c].val ?: best;
+	}
+	return best;
+}
+
+static __attribute__((pure)) uint64_t
+hash_str(const char *s, size_t z)
+{
+	/* FNV-1a */
+	uint64_t h = 0xcbf29ce484222325ULL;
+
+	for (size_t i = 0U; i < z; i++) {
+		h ^= (unsigned char)s[i];
+		h *= 0x100000001b3ULL;
+	}
+	return h;
+}
+
+static int
+pht_put(size_t i)
+{
+/* hash the name of pres[I], keep the load below 1/2 */
+	if (UNLIKELY(2U * (i + 1U) > zphtb)) {
+		const size_t nuz = zphtb ? zphtb << 1U : 256U;
+		uint32_t *nut = mmap(NULL, nuz * sizeof(*nut),
+				     PROT_RW, MAP_MEM, -1, 0);
+
+		if (UNLIKELY(nut == MAP_FAILED)) {
+			return -1;
+		} else if (phtb != NULL) {
+			munmap(phtb, zphtb * sizeof(*phtb));
+		}
+		phtb = nut;
+		zphtb = nuz;
+		/* rehash */
+		for (size_t j = 0U; j < i; j++) {
+			size_t k = hash_str(pres[j].prfx.str, pres[j].prfx.len);
+
+			for (; phtb[k &= zphtb - 1U]; k++);
+			phtb[k] = j + 1U;
+		}
+	}
+	with (size_t k = hash_str(pres[i].prfx.str, pres[i].prfx.len)) {
+		for (; phtb[k &= zphtb - 1U]; k++);
+		phtb[k] = i + 1U;
+	}
+	return 0;
+}
+
+static void
+pht_sync(void)
+{
+/* hash what's new */
+	for (; nhpres < npres; nhpres++) {
+		(void)pht_put(nhpres);
+	}
+	return;
+}
+
+static size_t
+pht_get(const char *s, size_t z)
+{
+/* return 1 + index into pres of prefix S of length Z, or 0 */
+	size_t k;
+
+	pht_sync();
+	if (UNLIKELY(phtb == NULL)) {
+		return 0U;
+	}
+	for (k = hash_str(s, z); phtb[k &= zphtb - 1U]; k++) {
+		const size_t i = phtb[k] - 1U;
+
+		if (pres[i].prfx.len == z && !memcmp(pres[i].prfx.str, s, z)) {
+			return i + 1U;
+		}
+	}
+	return 0U;
+}
+
+static void
+free_idx(void)
+{
+	if (tri != NULL) {
+		munmap(tri, ztri * sizeof(*tri));
+	}
+	tri = NULL;
+	ntri = ztri = 0U;
+	ntpres = 0U;
+
+	if (phtb != NULL) {
+		munmap(phtb, zphtb * sizeof(*phtb));
+	}
+	phtb = NULL;
+	zphtb = 0U;
+	nhpres = 0U;
+	return;
+}
+
+
 /* prefix handling */
+static inline bool
+pn_base_p(char c)
+{
+/* whether C may start a prefix name, PN_CHARS_BASE that is,
+ * anything beyond ASCII is let through */
+	return isalpha((unsigned char)c) || (unsigned char)c >= 0x80U;
+}
+
 static size_t
-subst(char *str, size_t len)
+pn_local_c(const char *s, size_t i, size_t z)
 {
-/* expects STR to be \nul-term'd */
-	char *sp = str;
-	char *cp = NULL;
-	char *pp = NULL;
+/* classify the character at I of the local name S of length Z,
+ * return 1 if it goes verbatim, 2 if it needs a backslash, 3 for
+ * a %XX sequence and 0 if it can't be in a PN_LOCAL at all */
+	switch (s[i]) {
+	case '_':
+	case ':':
+		return 1U;
+	case '-':
+		return 1U + !i;
+	case '.':
+		return 1U + (!i || i + 1U >= z);
+	case '%':
+		if (i + 2U < z &&
+		    isxdigit((unsigned char)s[i + 1U]) &&
+		    isxdigit((unsigned char)s[i + 2U])) {
+			return 3U;
+		}
+		/* fallthrough */
+	case '~': case '!': case '$': case '&': case '\'':
+	case '(': case ')': case '*': case '+': case ',':
+	case ';': case '=': case '/': case '?': case '#': case '@':
+		return 2U;
+	default:
+		break;
+	}
+	return pn_base_p(s[i]) || isdigit((unsigned char)s[i]);
+}
 
-	for (char *tp; (tp = strchr(sp, '<')) != NULL; sp = tp) {
-		tp++;
-		for (size_t i = 0U; i < npres; i++) {
-			char *ep;
+static size_t
+pn_local_len(const char *s, size_t z)
+{
+/* return the length of S of length Z as PN_LOCAL, escapes included,
+ * or -1 if it can't be written as one */
+	size_t n = 0U;
 
-			/* check if it's an URI we know of
-			 * and find its end */
-			if (memcmp(tp, pres[i].puri.str, pres[i].puri.len)) {
-				continue;
-			} else if (UNLIKELY((ep = strchr(tp, '>')) == NULL)) {
+	for (size_t i = 0U, k; i < z; i += k < 3U ? 1U : 3U, n += k) {
+		if (!(k = pn_local_c(s, i, z))) {
+			return (size_t)-1;
+		}
+	}
+	return n;
+}
+
+static size_t
+pn_local_cpy(char *restrict buf, const char *s, size_t z)
+{
+/* copy S of length Z to BUF escaping it as PN_LOCAL, S must have
+ * passed pn_local_len(), return the number of bytes written */
+	char *bp = buf;
+
+	for (size_t i = 0U; i < z; i++) {
+		switch (pn_local_c(s, i, z)) {
+		case 2U:
+			*bp++ = '\\';
+			break;
+		case 3U:
+			*bp++ = s[i++];
+			*bp++ = s[i++];
+			break;
+		default:
+			break;
+		}
+		*bp++ = s[i];
+	}
+	return bp - buf;
+}
+
+static const char*
+skip_lit(const char *sp, const char *ep)
+{
+/* return a pointer past the literal whose opening quote is at SP,
+ * long literals included */
+	const char q = *sp;
+
+	if (sp + 2U < ep && sp[1U] == q && sp[2U] == q) {
+		for (sp += 3U; sp + 2U < ep &&
+			     (*sp != q || sp[1U] != q || sp[2U] != q);
+		     sp += 1U + (*sp == '\\'));
+		sp += 3U;
+	} else {
+		/* find an unescaped closing quote */
+		for (const char *tp; ++sp < ep &&
+			     (tp = memchr(sp, q, ep - sp)) != NULL; sp = tp) {
+			size_t nbs = 0U;
+
+			for (; tp - nbs > sp && tp[-1 - (ssize_t)nbs] == '\\'; nbs++);
+			if (!(nbs % 2U)) {
+				return tp + 1U;
+			}
+		}
+		return ep;
+	}
+	return sp < ep ? sp : ep;
+}
+
+static size_t
+subst(char *restrict buf, const char *s, size_t z)
+{
+/* copy statement S of length Z to BUF substituting prefixes for the
+ * namespaces of its IRIs, literals and comments go verbatim, return
+ * the number of bytes written, which is no more than Z */
+	const char *const ep = s + z;
+	/* beginning of what's still to be copied */
+	const char *cp = s;
+	char *bp = buf;
+
+	for (const char *sp = s; sp < ep;) {
+		const char *tp, *lp;
+		size_t i, lz;
+
+		switch (*sp) {
+		case '<':
+			if (UNLIKELY((tp = memchr(sp, '>', ep - sp)) == NULL)) {
 				/* big cluster fuck */
-				return 0U;
+				goto out;
+			} else if (!(i = tri_get(sp + 1U))) {
+				/* no prefix, keep the IRI */
+				sp = tp + 1U;
+				continue;
 			}
-			/* great, memmove the whole shebang */
-			if (cp) {
-				memmove(pp, cp, tp - 1U - cp);
-				pp += tp - 1U - cp;
-			} else {
-				pp = tp - 1U;
+			/* the local name and its length once escaped */
+			lp = sp + 1U + pres[--i].puri.len;
+			lz = pn_local_len(lp, tp - lp);
+			if (lz == (size_t)-1 ||
+			    pres[i].prfx.len + 1U/*:*/ + lz >
+			    (size_t)(tp + 1U - sp)) {
+				/* not a local name or a prefixed name longer
+				 * than the IRI, keep the IRI, the output must
+				 * never outgrow the input */
+				sp = tp + 1U;
+				continue;
 			}
-
+			/* copy what's before the IRI */
+			memcpy(bp, cp, sp - cp);
+			bp += sp - cp;
 			/* actually substitute for the prefix */
-			memcpy(pp, pres[i].prfx.str, pres[i].prfx.len);
-			pp += pres[i].prfx.len;
-			*pp++ = ':';
-			/* move value now */
-			with (size_t pz = pres[i].puri.len) {
-				memmove(pp, tp + pz, ep - (tp + pz));
-				/* store annex point for future run */
-				pp += ep - (tp + pz);
+			memcpy(bp, pres[i].prfx.str, pres[i].prfx.len);
+			bp += pres[i].prfx.len;
+			*bp++ = ':';
+			/* and the rest of the IRI as local name */
+			bp += pn_local_cpy(bp, lp, tp - lp);
+			cp = sp = tp + 1U/*>*/;
+			continue;
+		case '\\':
+			/* escape in a local name */
+			sp += 2U;
+			continue;
+		case '"':
+		case '\'':
+			sp = skip_lit(sp, ep);
+			continue;
+		case '#':
+			/* comment */
+			if ((sp = memchr(sp, '\n', ep - sp)) == NULL) {
+				goto out;
 			}
-			/* and set TP (to get SP) for the next round */
-			cp = tp = ep + 1U/*>*/;
+			continue;
+		default:
+			sp++;
+			continue;
+		}
+	}
+out:
+	/* final copy */
+	memcpy(bp, cp, ep - cp);
+	bp += ep - cp;
+	return bp - buf;
+}
+
+static void
+mark_used(const char *s, size_t z, bool *u)
+{
+/* mark the prefixes of the prefixed names in statement S as used,
+ * in U indexed like pres if given, in pres itself otherwise */
+	const char *const ep = s + z;
+
+	for (const char *sp = s; sp < ep;) {
+		const char *tp;
+
+		switch (*sp) {
+		case '<':
+			/* IRIs have no prefixed names */
+			if ((sp = memchr(sp, '>', ep - sp)) == NULL) {
+				return;
+			}
+			sp++;
+			continue;
+		case '"':
+		case '\'':
+			sp = skip_lit(sp, ep);
+			continue;
+		case '#':
+			/* comment */
+			if ((sp = memchr(sp, '\n', ep - sp)) == NULL) {
+				return;
+			}
+			continue;
+		default:
 			break;
 		}
+		if (*sp == '_' && sp + 1U < ep && sp[1U] == ':') {
+			/* blank node label, no prefix in there */
+			tp = sp + 2U;
+			goto skip;
+		} else if (!pn_base_p(*sp) && *sp != ':') {
+			sp++;
+			continue;
+		}
+		/* a word, and a prefixed name if there's a colon,
+		 * a bare colon being the empty prefix */
+		for (tp = sp; tp < ep && (pn_base_p(*tp) ||
+					  isdigit((unsigned char)*tp) ||
+					  *tp == '_' || *tp == '-' || *tp == '.');
+		     tp++);
+		if (tp < ep && *tp == ':') {
+			size_t i;
+
+			for (; tp > sp && tp[-1] == '.'; tp--);
+			if (!(i = pht_get(sp, tp - sp))) {
+				;
+			} else if (u != NULL) {
+				u[i - 1U] = true;
+			} else {
+				pres[i - 1U].used = true;
+			}
+		}
+	skip:
+		for (sp = tp; sp < ep && !isspace((unsigned char)*sp) &&
+			     *sp != '<' &&
+			     *sp != '"' && *sp != '\'' && *sp != '#' &&
+			     *sp != ';' && *sp != ','; sp++) {
+			/* escapes in local names */
+			sp += *sp == '\\';
+		}
 	}
-	/* final move */
-	if (cp) {
-		memmove(pp, cp, str + len - cp);
-		pp += str + len - cp;
-		len = pp - str;
+	return;
+}
+
+static int
+parse_prefix(struct str_s *p, struct str_s *u, const char *str, size_t len)
+{
+/* find prefix name and namespace of the @prefix directive in STR */
+	const char *const ep = str + len;
+	const char *tp;
+
+	if (len < 8U) {
+		return -1;
+	} else if (memcmp(str, "@prefix", 7U) &&
+		   memcmp(str, "@PREFIX", 7U)) {
+		return -1;
+	} else if (!isspace(str[7U])) {
+		return -1;
 	}
-	return len;
+	/* skip leading whitespace */
+	for (p->str = str + 8U; p->str < ep && isspace(*p->str); p->str++);
+	/* find end of prefix */
+	if (UNLIKELY((tp = memchr(p->str, ':', ep - p->str)) == NULL)) {
+		return -1;
+	}
+	/* rewind over trailing whitespace */
+	for (p->len = tp - p->str;
+	     p->len && isspace(p->str[p->len - 1U]); p->len--);
+
+	/* find the url bit */
+	if (UNLIKELY((u->str = memchr(tp, '<', ep - tp)) == NULL)) {
+		return -1;
+	} else if (UNLIKELY((tp = memchr(u->str, '>', ep - u->str)) == NULL)) {
+		return -1;
+	}
+	/* adjust */
+	u->str++;
+	u->len = tp - u->str;
+	return 0;
 }
 
 static int
@@ -197,8 +736,6 @@ add_prefix(const char *str, size_t len)
  * 1 if prefix already has been registered */
 	struct str_s p;
 	struct str_s u;
-	const char *const ep = str + len;
-	const char *tp;
 	static char _prb[4096U];
 	static char *prb = _prb;
 	static size_t prz = sizeof(_prb);
@@ -206,11 +743,15 @@ add_prefix(const char *str, size_t len)
 
 #define fini_prefix()	add_prefix(NULL, 0U)
 	if (UNLIKELY(len == 0U)) {
+		free_idx();
 		if (pres != dflt_pres) {
 			(void)munmap(pres, zpres * sizeof(*pres));
 		}
 		pres = dflt_pres;
 		npres = 4U;
+		for (size_t i = 0U; i < npres; i++) {
+			pres[i].used = false;
+		}
 		if (prb != _prb) {
 			munmap(prb, prz);
 			prb = _prb;
@@ -219,101 +760,822 @@ add_prefix(const char *str, size_t len)
 		return 0;
 	}
 
-	if (memcmp(str, "@prefix", 7U) &&
-	    memcmp(str, "@PREFIX", 7U)) {
-		return -1;
-	} else if (!isspace(str[7U])) {
+	if (parse_prefix(&p, &u, str, len) < 0) {
 		return -1;
+	} else if (pht_get(p.str, p.len)) {
+		/* FUCK, if the urls are different :/ */
+		return 1;
 	}
-	/* skip leading whitespace */
-	for (p.str = str + 8U; p.str < ep && isspace(*p.str); p.str++);
-	/* find end of prefix */
-	if (UNLIKELY((tp = memchr(p.str, ':', ep - p.str)) == NULL)) {
-		return -1;
+	/* check for room in the prefix buffer */
+	if (UNLIKELY(pix + p.len + u.len > prz)) {
+		/* resize */
+		size_t nuz = pix + p.len + u.len;
+		char *old = prb;
+		ptrdiff_t dlt;
+
+		RESZ(prb, prz, next_2pow(nuz))
+		else {
+			return -1;
+		}
+		dlt = prb - old;
+		for (size_t i = 4U; i < npres; i++) {
+			pres[i].prfx.str += dlt;
+			pres[i].puri.str += dlt;
+		}
+	}
+	/* add him to the list of pres */
+	if (UNLIKELY(npres >= zpres)) {
+		/* resize */
+		RESZ_S(pres, zpres, zpres << 1U)
+		else {
+			return -1;
+		}
 	}
-	/* rewind over trailing whitespace */
-	for (p.len = tp - p.str; p.len && isspace(p.str[p.len - 1U]); p.len--);
 
-	/* find the url bit */
-	if (UNLIKELY((u.str = memchr(tp, '<', ep - tp)) == NULL)) {
-		return -1;
-	} else if (UNLIKELY((tp = memchr(u.str, '>', ep - u.str)) == NULL)) {
+	/* copy details over to prefix buffer */
+	memcpy(prb + pix, p.str, p.len);
+	p.str = prb + pix;
+	pix += p.len;
+	memcpy(prb + pix, u.str, u.len);
+	u.str = prb + pix;
+	pix += u.len;
+
+	/* and assign */
+	pres[npres].prfx = p;
+	pres[npres].puri = u;
+	pres[npres].used = false;
+	npres++;
+	return 0;
+}
+
+
+/* namespace dictionaries */
+static int
+ld_prefixes(const char *fn)
+{
+/* load FN, a dictionary image or turtle with @prefix directives */
+	struct pfxdict_kv_s *kv = NULL;
+	size_t nkv = 0U, zkv = 0U;
+	struct stat st;
+	const char *m = NULL;
+	size_t mz;
+	int fd;
+
+	if ((fd = open(fn, O_RDONLY)) < 0) {
 		return -1;
+	} else if (fstat(fd, &st) < 0) {
+		goto fuck;
+	} else if ((mz = st.st_size) > 0U &&
+		   (m = mmap(NULL, mz, PROT_READ, MAP_SHARED, fd, 0)) == MAP_FAILED) {
+		goto fuck;
 	}
-	/* adjust */
-	u.str++;
-	u.len = tp - u.str;
+	close(fd);
 
-	for (size_t i = 0U; i < npres; i++) {
-		if (p.len != pres[i].prfx.len) {
-			;
-		} else if (memcmp(pres[i].prfx.str, p.str, p.len)) {
-			;
-		} else if (u.len != pres[i].puri.len) {
-			/* FUCK, the prefixes are identical but
-			 * the urls are different :/ */
-			return 1;
-		} else if (memcmp(pres[i].puri.str, u.str, u.len)) {
-			/* FUCK, the prefixes are identical but
-			 * the urls are different :/ */
-			return 1;
+	if (mz >= sizeof(PFXDICT_MAGIC) - 1U &&
+	    !memcmp(m, PFXDICT_MAGIC, sizeof(PFXDICT_MAGIC) - 1U)) {
+		/* compiled already, just use the map */
+		if (UNLIKELY(pfxdict_chk(m, mz) < 0)) {
+			munmap(deconst(m), mz);
+			errno = EINVAL;
+			return -1;
+		}
+		udict = deconst(m);
+		udictz = mz;
+		udmapp = true;
+		return 0;
+	}
+	/* collect directives, one per line */
+	for (const char *sp = m, *const ep = m + mz, *eol; sp < ep; sp = eol + 1) {
+		struct str_s p, u;
+
+		if ((eol = memchr(sp, '\n', ep - sp)) == NULL) {
+			eol = ep;
+		}
+		for (; sp < eol && isspace(*sp); sp++);
+		if (parse_prefix(&p, &u, sp, eol - sp) < 0) {
+			continue;
+		}
+		if (UNLIKELY(nkv >= zkv)) {
+			size_t nuz = zkv ? zkv << 1U : 256U;
+			void *nukv = realloc(kv, nuz * sizeof(*kv));
+
+			if (UNLIKELY(nukv == NULL)) {
+				break;
+			}
+			kv = nukv;
+			zkv = nuz;
+		}
+		kv[nkv++] = (struct pfxdict_kv_s){p.str, p.len, u.str, u.len};
+	}
+	udict = pfxdict_make(&udictz, kv, nkv);
+	udmapp = false;
+	free(kv);
+	if (mz) {
+		munmap(deconst(m), mz);
+	}
+	return udict != NULL ? 0 : -1;
+
+fuck:
+	close(fd);
+	return -1;
+}
+
+static void
+free_dicts(void)
+{
+	if (udict != NULL && udmapp) {
+		munmap(udict, udictz);
+	} else if (udict != NULL) {
+		free(udict);
+	}
+	udict = NULL;
+	ndicts = 0U;
+	return;
+}
+
+static size_t
+adopt(char *restrict buf, size_t bsz, const char *s, size_t z)
+{
+/* find an IRI in S that no prefix covers yet but whose namespace is
+ * in one of the dictionaries, write a directive for it into BUF and
+ * return its length, or 0 if there's no such IRI */
+	const char *const ep = s + z;
+
+	for (const char *tp = s, *ie; (tp = memchr(tp, '<', ep - tp)) != NULL;
+	     tp = ie) {
+		const char *ds;
+
+		tp++;
+		if (UNLIKELY((ie = memchr(tp, '>', ep - tp)) == NULL)) {
+			break;
+		} else if (tri_get(tp)) {
+			/* covered */
+			continue;
+		}
+		/* stems start after the authority's slashes */
+		for (ds = tp; ds < ie && *ds != ':'; ds++);
+		if (ie - ds < 3 || ds[1U] != '/' || ds[2U] != '/') {
+			continue;
+		}
+		/* longest stem first */
+		for (const char *dp = ie; --dp > ds + 2U;) {
+			if (*dp != '/' && *dp != '#' && *dp != ':') {
+				continue;
+			}
+			for (size_t i = 0U; i < ndicts; i++) {
+				const char *pf;
+				size_t pfz, dz;
+
+				pf = pfxdict_get(dicts[i], tp, dp + 1U - tp, &pfz);
+				if (pf == NULL || pht_get(pf, pfz)) {
+					/* unknown, or the name is taken */
+					continue;
+				}
+				dz = snprintf(buf, bsz, "@prefix %.*s: <%.*s> .",
+					      (int)pfz, pf, (int)(dp + 1U - tp), tp);
+				if (LIKELY(dz < bsz)) {
+					return dz;
+				}
+			}
+		}
+	}
+	return 0U;
+}
+
+
+static void wr_stmt(const char *s, size_t z);
+
+/* prefix discovery, namespace stems are counted with Space-Saving,
+ * weighted by stem length, over a bounded number of counters */
+#define NSTEM		(1024U)
+#define NSBKT		(2U * NSTEM)
+
+struct stem_s {
+	const char *s;
+	size_t z;
+	uint64_t h;
+	/* bytes covered, and how much of that may be overestimated */
+	uint64_t cnt;
+	uint64_t err;
+	/* 1 + index of next stem in the bucket chain, or 0 */
+	uint32_t nxt;
+	/* position in the heap */
+	uint32_t hix;
+};
+
+struct ssum_s {
+	struct stem_s st[NSTEM];
+	uint32_t bkt[NSBKT];
+	/* min heap over cnt, of stem indices */
+	uint32_t hp[NSTEM];
+	size_t n;
+};
+
+static void
+ss_down(struct ssum_s *ss, size_t i)
+{
+	for (size_t c; (c = 2U * i + 1U) < ss->n; i = c) {
+		const uint32_t x = ss->hp[i];
+
+		if (c + 1U < ss->n &&
+		    ss->st[ss->hp[c + 1U]].cnt < ss->st[ss->hp[c]].cnt) {
+			c++;
+		}
+		if (ss->st[x].cnt <= ss->st[ss->hp[c]].cnt) {
+			break;
+		}
+		ss->hp[i] = ss->hp[c];
+		ss->hp[c] = x;
+		ss->st[ss->hp[i]].hix = i;
+		ss->st[x].hix = c;
+	}
+	return;
+}
+
+static void
+ss_up(struct ssum_s *ss, size_t i)
+{
+	for (size_t p; i && ss->st[ss->hp[i]].cnt < ss->st[ss->hp[p = (i - 1U) / 2U]].cnt; i = p) {
+		const uint32_t x = ss->hp[i];
+
+		ss->hp[i] = ss->hp[p];
+		ss->hp[p] = x;
+		ss->st[ss->hp[i]].hix = i;
+		ss->st[x].hix = p;
+	}
+	return;
+}
+
+static void
+ss_unchain(struct ssum_s *ss, uint32_t i)
+{
+	uint32_t *ip = ss->bkt + ss->st[i].h % NSBKT;
+
+	for (; *ip != i + 1U; ip = &ss->st[*ip - 1U].nxt);
+	*ip = ss->st[i].nxt;
+	return;
+}
+
+static void
+ss_add(struct ssum_s *ss, const char *s, size_t z)
+{
+	const uint64_t h = hash_str(s, z);
+	uint32_t *bp = ss->bkt + h % NSBKT;
+	uint32_t i;
+
+	for (uint32_t k = *bp; k; k = ss->st[k - 1U].nxt) {
+		struct stem_s *x = ss->st + k - 1U;
+
+		if (x->h == h && x->z == z && !memcmp(x->s, s, z)) {
+			x->cnt += z;
+			ss_down(ss, x->hix);
+			return;
+		}
+	}
+	if (ss->n < NSTEM) {
+		i = ss->n++;
+		ss->st[i] = (struct stem_s){s, z, h, z, 0U, *bp, ss->n - 1U};
+		ss->hp[i] = i;
+		*bp = i + 1U;
+		ss_up(ss, i);
+		return;
+	}
+	/* replace the least counted stem, inheriting its count as error */
+	i = ss->hp[0U];
+	ss_unchain(ss, i);
+	with (struct stem_s *x = ss->st + i) {
+		x->s = s;
+		x->z = z;
+		x->h = h;
+		x->err = x->cnt;
+		x->cnt += z;
+		x->nxt = *bp;
+	}
+	*bp = i + 1U;
+	ss_down(ss, 0U);
+	return;
+}
+
+static __attribute__((pure)) int64_t
+stem_save(const struct stem_s *x, size_t pz)
+{
+/* bytes saved by a prefix of length PZ for X, at least */
+	const uint64_t nhit = (x->cnt - x->err) / x->z;
+
+	return (int64_t)nhit * ((int64_t)x->z - (int64_t)pz - 1) -
+		(int64_t)(x->z + pz + 14U/*@prefix : <> .\n*/);
+}
+
+static int
+stem_cmp(const void *a, const void *b)
+{
+	const int64_t sa = stem_save(a, 3U);
+	const int64_t sb = stem_save(b, 3U);
+
+	return (sa < sb) - (sa > sb);
+}
+
+static size_t
+stem_name(char *restrict buf, size_t bsz, const char *s, size_t z)
+{
+/* come up with a name for stem S of length Z, from its last segment */
+	const char *sp = s + z - 1U;
+	size_t n = 0U;
+
+	for (; sp > s && sp[-1] != '/' && sp[-1] != '#'; sp--);
+	if (sp + 4U < s + z && !memcmp(sp, "www.", 4U)) {
+		sp += 4U;
+	}
+	if (isalpha(*sp)) {
+		for (; n < 8U && n < bsz && isalnum(sp[n]); n++) {
+			buf[n] = (char)tolower(sp[n]);
+		}
+	}
+	if (!n) {
+		memcpy(buf, "ns", n = 2U);
+	}
+	if (pht_get(buf, n)) {
+		/* number it then */
+		const size_t m = n;
+
+		for (unsigned int k = 1U; k && pht_get(buf, n); k++) {
+			n = m + snprintf(buf + m, bsz - m, "%u", k);
+		}
+	}
+	return n;
+}
+
+static void
+auto_pfx(const char *buf, size_t bsz)
+{
+/* discover namespaces in the BSZ bytes of BUF and declare the ones
+ * worth a prefix */
+	struct ssum_s *ss;
+	const char *const ep = buf + bsz;
+
+	if (UNLIKELY((ss = calloc(1U, sizeof(*ss))) == NULL)) {
+		return;
+	}
+	/* the input's own prefixes come first, their names are taken */
+	with (const size_t hz = range_head(buf, bsz)) {
+		struct scan_s x = {0U};
+		const char *sp = buf, *bo;
+
+		for (const char *eo;
+		     (eo = scan_last(&x, &bo, sp, buf + hz)) != NULL; sp = eo) {
+			char dir[4096U];
+			const char *d = bo;
+			size_t z = eo - bo;
+			struct str_s p, u;
+
+			if (*bo != '@' && (z = scan_dir(dir, sizeof(dir), bo, z))) {
+				d = dir;
+			}
+			if (parse_prefix(&p, &u, d, z) == 0) {
+				wr_stmt(d, z);
+			}
+		}
+	}
+	for (const char *tp = buf, *ie; (tp = memchr(tp, '<', ep - tp)) != NULL;
+	     tp = ie) {
+		const char *ds = NULL, *dp = NULL;
+
+		/* find the end and the last delimiter, for something like
+		 * an IRI anyway, < in literals give us garbage otherwise */
+		for (ie = ++tp; ie < ep && *ie != '>'; ie++) {
+			switch (*ie) {
+			case '/':
+			case '#':
+				dp = ie;
+				break;
+			case ':':
+				ds = ds ?: ie;
+				break;
+			case ' ':
+			case '\t':
+			case '\n':
+			case '"':
+			case '<':
+				goto next;
+			default:
+				break;
+			}
+		}
+		if (ie >= ep || ds == NULL || dp == NULL) {
+			continue;
+		} else if (ie - ds < 3 || ds[1U] != '/' || ds[2U] != '/') {
+			continue;
+		} else if (dp <= ds + 2U) {
+			/* that's the scheme's slashes */
+			continue;
+		}
+		ss_add(ss, tp, dp + 1U - tp);
+	next:
+		;
+	}
+
+	/* best first */
+	qsort(ss->st, ss->n, sizeof(*ss->st), stem_cmp);
+	for (size_t i = 0U; i < ss->n && stem_save(ss->st + i, 3U) > 0; i++) {
+		const struct stem_s *x = ss->st + i;
+		char dir[4096U];
+		char nm[24U];
+		const char *pf = NULL;
+		size_t pz, dz;
+
+		if (x->z > 2048U) {
+			continue;
+		} else if ((pz = tri_get(x->s)) && pres[pz - 1U].puri.len >= x->z) {
+			/* covered */
+			continue;
+		}
+		/* dictionaries know better names */
+		for (size_t j = 0U; j < ndicts && pf == NULL; j++) {
+			if ((pf = pfxdict_get(dicts[j], x->s, x->z, &pz)) &&
+			    pht_get(pf, pz)) {
+				pf = NULL;
+			}
+		}
+		if (pf == NULL) {
+			pz = stem_name(nm, sizeof(nm), x->s, x->z - 1U);
+			pf = nm;
+		}
+		if (stem_save(x, pz) <= 0) {
+			continue;
+		}
+		dz = snprintf(dir, sizeof(dir), "@prefix %.*s: <%.*s> .",
+			      (int)pz, pf, (int)x->z, x->s);
+		wr_stmt(dir, dz);
+	}
+	free(ss);
+	return;
+}
+
+
+/* buffer handling */
+static void
+ip_flush(void)
+{
+/* move what's pending to the file, as far as the read cursor allows */
+	const size_t room = iprd - (ipm + ipwr);
+	const size_t n = ipnpnd < room ? ipnpnd : room;
+
+	memcpy(ipm + ipwr, ippnd, n);
+	memmove(ippnd, ippnd + n, ipnpnd - n);
+	ipwr += n;
+	ipnpnd -= n;
+	return;
+}
+
+static size_t
+ip_put(const char *buf, size_t bsz)
+{
+/* write BUF behind the read cursor, what's too much is kept pending */
+	ip_flush();
+	if (!ipnpnd) {
+		const size_t room = iprd - (ipm + ipwr);
+		const size_t n = bsz < room ? bsz : room;
+
+		memcpy(ipm + ipwr, buf, n);
+		ipwr += n;
+		buf += n;
+		bsz -= n;
+	}
+	if (UNLIKELY(ipnpnd + bsz > ipzpnd)) {
+		const size_t nuz = next_2pow(ipnpnd + bsz);
+		char *nub = realloc(ippnd, nuz);
+
+		if (UNLIKELY(nub == NULL)) {
+			return 0U;
+		}
+		ippnd = nub;
+		ipzpnd = nuz;
+	}
+	memcpy(ippnd + ipnpnd, buf, bsz);
+	ipnpnd += bsz;
+	return bsz;
+}
+
+static size_t
+wr_buf(int fd, const char *buf, size_t bsz)
+{
+	size_t tot = 0U;
+
+	if (UNLIKELY(ipm != NULL) && fd == ipfd) {
+		return ip_put(buf, bsz);
+	} else if (sob != NULL && fd == STDOUT_FILENO) {
+		return obuf_write(sob, buf, bsz) < 0 ? 0U : bsz;
+	}
+	for (ssize_t nwr;
+	     tot < bsz &&
+		     (nwr = write(fd, buf + tot, bsz - tot)) > 0;
+	     tot += nwr);
+	return tot;
+}
+
+static size_t
+fmt_stmt(char *restrict buf, const char *s, size_t z, bool *u)
+{
+/* format statement S into BUF, which has room for Z + 3 + FRAME_HDRZ
+ * bytes, substituting prefixes, return the number of bytes written,
+ * with --used-only also mark the prefixes used, see mark_used() */
+	const bool dirp = *s == '@';
+	size_t bix = 0U;
+
+	if (frmo) {
+		/* substitute behind the header, it only gets shorter */
+		const size_t hz = frame_hdrz(z);
+		char *sp = buf + hz;
+
+		if (dirp) {
+			memcpy(sp, s, z);
 		} else {
-			return 1;
+			z = subst(sp, s, z);
 		}
-	};
-	/* check for room in the prefix buffer */
-	if (UNLIKELY(pix + p.len + u.len > prz)) {
-		/* resize */
-		size_t nuz = pix + p.len + u.len;
-		char *old = prb;
-		ptrdiff_t dlt;
+		if (spfp != NULL && !dirp) {
+			mark_used(sp, z, u);
+		}
+		with (size_t nh = frame_hdrz(z)) {
+			if (UNLIKELY(nh < hz)) {
+				memmove(buf + nh, sp, z);
+			}
+		}
+		bix += frame_put(buf, z, dirp);
+		return bix + z;
+	}
+
+	/* directives won't qualify as statements */
+	if (!dirp) {
+		buf[bix++] = '\n';
+	}
+	/* copy and substitute, if it's not a @prefix */
+	if (dirp) {
+		memcpy(buf + bix, s, z);
+	} else {
+		z = subst(buf + bix, s, z);
+	}
+	if (spfp != NULL && !dirp) {
+		mark_used(buf + bix, z, u);
+	}
+	/* append newline */
+	buf[bix += z] = '\n';
+	return ++bix;
+}
+
+static size_t
+wr_pres(char **bp, size_t *zp, size_t bix, int fd, bool usedp)
+{
+/* push our prefixes into *BP at BIX, or the used ones only if USEDP,
+ * flushing to FD as need be, return the new index */
+	for (size_t i = 0U; i < npres; i++) {
+		char *buf;
+		size_t adz = 8U/*@prefix*/ +
+			pres[i].prfx.len + 1U/*:*/ + 1U/* */ +
+			1U/*<*/ + pres[i].puri.len + 1U/*>*/ +
+			1U/* */ + 1U/*.*/ + 1U/*\n*/;
+
+		if (usedp && !pres[i].used) {
+			continue;
+		} else if (UNLIKELY(bix + adz + FRAME_HDRZ > *zp)) {
+			wr_buf(fd, *bp, bix);
+			bix = 0U;
+		}
+		if (UNLIKELY(adz + FRAME_HDRZ > *zp)) {
+			/* resize */
+			RESZ(*bp, *zp, next_2pow(adz + FRAME_HDRZ))
+			else {
+				break;
+			}
+		}
+		buf = *bp;
+
+		if (frmo) {
+			/* same thing sans newline */
+			bix += frame_put(buf + bix, adz - 1U, true);
+		}
+		memcpy(buf + bix, "@prefix ", 8U);
+		bix += 8U;
+		memcpy(buf + bix, pres[i].prfx.str, pres[i].prfx.len);
+		bix += pres[i].prfx.len;
+		buf[bix++] = ':';
+		buf[bix++] = ' ';
+		buf[bix++] = '<';
+		memcpy(buf + bix, pres[i].puri.str, pres[i].puri.len);
+		bix += pres[i].puri.len;
+		buf[bix++] = '>';
+		buf[bix++] = ' ';
+		buf[bix++] = '.';
+		if (!frmo) {
+			buf[bix++] = '\n';
+		}
+	}
+	return bix;
+}
+
+/* parallel substitution, batches of statements go out to the workers
+ * and their output is written in input order, the prefix tables are
+ * read-only while batches are out and only change after all of them
+ * are back, see jobs_drain() */
+#define BTCH_SIZE	(256U * 1024U)
+
+struct btch_s {
+	/* statements back to back, and the offset past each one */
+	char *ib;
+	size_t ibz;
+	size_t nib;
+	size_t *ie;
+	size_t iez;
+	size_t nie;
+	/* the formatted statements */
+	char *ob;
+	size_t obz;
+	size_t nob;
+	/* prefixes used by them, indexed like pres, with --used-only */
+	bool *u;
+	size_t uz;
+	size_t nu;
+	bool donep;
+};
+
+static pool_t jobs;
+/* ring of batches, BHD is the oldest one out, NBO the number out,
+ * the one after those is being filled */
+static struct btch_s *btch;
+static size_t nbtch;
+static size_t bhd;
+static size_t nbo;
+static pthread_mutex_t bmtx = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t bcnd = PTHREAD_COND_INITIALIZER;
+
+static void
+btch_work(void *clo)
+{
+	struct btch_s *b = clo;
+	size_t nob = 0U;
+
+	for (size_t i = 0U, o = 0U; i < b->nie; o = b->ie[i++]) {
+		nob += fmt_stmt(b->ob + nob, b->ib + o, b->ie[i] - o, b->u);
+	}
+
+	pthread_mutex_lock(&bmtx);
+	b->nob = nob;
+	b->donep = true;
+	pthread_cond_broadcast(&bcnd);
+	pthread_mutex_unlock(&bmtx);
+	return;
+}
+
+static void
+jobs_out1(int fd)
+{
+/* wait for the oldest batch and write it to FD */
+	struct btch_s *b = btch + bhd;
+
+	pthread_mutex_lock(&bmtx);
+	while (!b->donep) {
+		pthread_cond_wait(&bcnd, &bmtx);
+	}
+	pthread_mutex_unlock(&bmtx);
+
+	wr_buf(fd, b->ob, b->nob);
+	for (size_t i = 0U; b->u != NULL && i < b->nu; i++) {
+		pres[i].used |= b->u[i];
+	}
+	b->nib = b->nie = b->nob = 0U;
+	b->donep = false;
+	bhd = (bhd + 1U) % nbtch;
+	nbo--;
+	return;
+}
+
+static int
+jobs_send(int fd)
+{
+/* send the batch being filled off to the workers */
+	struct btch_s *b = btch + (bhd + nbo) % nbtch;
+	size_t obz;
+
+	if (!b->nie) {
+		return 0;
+	}
+	/* worst case, a frame header and newlines around every statement */
+	obz = b->nib + b->nie * (3U + FRAME_HDRZ);
+	if (UNLIKELY(obz > b->obz)) {
+		char *nub = realloc(b->ob, obz);
+
+		if (UNLIKELY(nub == NULL)) {
+			return -1;
+		}
+		b->ob = nub;
+		b->obz = obz;
+	}
+	if (spfp != NULL) {
+		if (UNLIKELY(npres > b->uz)) {
+			bool *nuu = realloc(b->u, npres * sizeof(*b->u));
+
+			if (UNLIKELY(nuu == NULL)) {
+				return -1;
+			}
+			b->u = nuu;
+			b->uz = npres;
+		}
+		memset(b->u, 0, npres * sizeof(*b->u));
+		b->nu = npres;
+	}
+	/* the workers mustn't be the ones to index new prefixes */
+	tri_sync();
+	pht_sync();
+
+	nbo++;
+	pool_push(jobs, btch_work, b);
+	if (nbo >= nbtch) {
+		/* keep one for filling */
+		jobs_out1(fd);
+	}
+	return 0;
+}
+
+static void
+jobs_drain(int fd)
+{
+	(void)jobs_send(fd);
+	while (nbo) {
+		jobs_out1(fd);
+	}
+	return;
+}
 
-		RESZ(prb, prz, next_2pow(nuz))
-		else {
-			return -1;
-		}
-		dlt = prb - old;
-		for (size_t i = 4U; i < npres; i++) {
-			pres[i].prfx.str += dlt;
-			pres[i].puri.str += dlt;
+static void
+jobs_add(int fd, const char *s, size_t z)
+{
+	struct btch_s *b = btch + (bhd + nbo) % nbtch;
+
+	if (b->nib + z > BTCH_SIZE && b->nie) {
+		if (UNLIKELY(jobs_send(fd) < 0)) {
+			return;
 		}
+		b = btch + (bhd + nbo) % nbtch;
 	}
-	/* add him to the list of pres */
-	if (UNLIKELY(npres >= zpres)) {
-		/* resize */
-		RESZ_S(pres, zpres, zpres << 1U)
-		else {
-			return -1;
+	if (UNLIKELY(b->nib + z > b->ibz)) {
+		const size_t nuz = next_2pow(b->nib + z);
+		char *nub = realloc(b->ib, nuz);
+
+		if (UNLIKELY(nub == NULL)) {
+			return;
 		}
+		b->ib = nub;
+		b->ibz = nuz;
 	}
+	if (UNLIKELY(b->nie >= b->iez)) {
+		const size_t nuz = b->iez ? b->iez << 1U : 1024U;
+		size_t *nue = realloc(b->ie, nuz * sizeof(*b->ie));
 
-	/* copy details over to prefix buffer */
-	memcpy(prb + pix, p.str, p.len);
-	p.str = prb + pix;
-	pix += p.len;
-	memcpy(prb + pix, u.str, u.len);
-	u.str = prb + pix;
-	pix += u.len;
+		if (UNLIKELY(nue == NULL)) {
+			return;
+		}
+		b->ie = nue;
+		b->iez = nuz;
+	}
+	memcpy(b->ib + b->nib, s, z);
+	b->ie[b->nie++] = b->nib += z;
+	return;
+}
 
-	/* and assign */
-	pres[npres].prfx = p;
-	pres[npres].puri = u;
-	npres++;
+static int
+init_jobs(unsigned int nj)
+{
+	if (!nj) {
+		long int ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+		nj = ncpu > 0 ? (unsigned int)ncpu : 1U;
+	}
+	nbtch = 2U * nj + 1U;
+	if (UNLIKELY((btch = calloc(nbtch, sizeof(*btch))) == NULL)) {
+		return -1;
+	} else if (UNLIKELY((jobs = make_pool(nj, 0U)) == NULL)) {
+		free(btch);
+		btch = NULL;
+		return -1;
+	}
 	return 0;
 }
 
-
-/* buffer handling */
-static size_t
-wr_buf(int fd, const char *buf, size_t bsz)
+static void
+fini_jobs(void)
 {
-	size_t tot = 0U;
-
-	for (ssize_t nwr;
-	     tot < bsz &&
-		     (nwr = write(fd, buf + tot, bsz - tot)) > 0;
-	     tot += nwr);
-	return tot;
+	if (jobs == NULL) {
+		return;
+	}
+	free_pool(jobs);
+	jobs = NULL;
+	for (size_t i = 0U; i < nbtch; i++) {
+		free(btch[i].ib);
+		free(btch[i].ie);
+		free(btch[i].ob);
+		free(btch[i].u);
+	}
+	free(btch);
+	btch = NULL;
+	return;
 }
 
 static void
@@ -323,14 +1585,35 @@ wr_stmt(const char *s, size_t z)
 	static char *buf = _buf;
 	static size_t bsz = sizeof(_buf);
 	static size_t bix = 0U;
-	static const int cfd = STDOUT_FILENO;
+	/* statements go to the spill file with --used-only */
+	const int ofd = spfp != NULL ? fileno(spfp) : cfd;
 
 #define fini_stmt()	wr_stmt(NULL, 0U)
 	if (UNLIKELY(z == 0U)) {
 		/* flushing instruction */
-		if (LIKELY(cfd >= 0)) {
+		if (jobs != NULL) {
+			jobs_drain(ofd);
+		}
+		wr_buf(ofd, buf, bix);
+		bix = 0U;
+
+		if (spfp != NULL) {
+			/* now that we know which prefixes are used, write them
+			 * and then what's been held back */
+			ssize_t nrd;
+
+			if (frmo && !magp) {
+				memcpy(buf, FRAME_MAGIC, bix = FRAME_MAGIC_LEN);
+				magp = true;
+			}
+			bix = wr_pres(&buf, &bsz, bix, cfd, true);
 			wr_buf(cfd, buf, bix);
-			close(cfd);
+			bix = 0U;
+			for (lseek(ofd, 0, SEEK_SET);
+			     (nrd = read(ofd, buf, bsz)) > 0; wr_buf(cfd, buf, nrd));
+			/* ready for the next file */
+			lseek(ofd, 0, SEEK_SET);
+			(void)ftruncate(ofd, 0);
 		}
 
 		if (buf != _buf) {
@@ -338,200 +1621,139 @@ wr_stmt(const char *s, size_t z)
 			buf = _buf;
 			bsz = sizeof(_buf);
 		}
-		bix = 0U;
 
 		fini_prefix();
 		return;
 	}
 
-	if (UNLIKELY(bix == 0U)) {
-		/* time to push our prefixes in */
-		for (size_t i = 0U; i < npres; i++) {
-			size_t adz = 8U/*@prefix*/ +
-				pres[i].prfx.len + 1U/*:*/ + 1U/* */ +
-				1U/*<*/ + pres[i].puri.len + 1U/*>*/ +
-				1U/* */ + 1U/*.*/ + 1U/*\n*/;
-
-			if (UNLIKELY(bix + adz > bsz)) {
-				/* resize */
-				RESZ(buf, bsz, next_2pow(adz))
-				else {
-					return;
-				}
+	if (ndicts && *s != '@') {
+		/* declare namespaces from the dictionaries as we go */
+		char dir[4096U];
+
+		for (size_t dz, n; (dz = adopt(dir, sizeof(dir), s, z));) {
+			n = npres;
+			wr_stmt(dir, dz);
+			if (UNLIKELY(npres <= n)) {
+				/* no good, leave it unprefixed */
+				break;
 			}
+		}
+	}
 
-			memcpy(buf + bix, "@prefix ", 8U);
-			bix += 8U;
-			memcpy(buf + bix, pres[i].prfx.str, pres[i].prfx.len);
-			bix += pres[i].prfx.len;
-			buf[bix++] = ':';
-			buf[bix++] = ' ';
-			buf[bix++] = '<';
-			memcpy(buf + bix, pres[i].puri.str, pres[i].puri.len);
-			bix += pres[i].puri.len;
-			buf[bix++] = '>';
-			buf[bix++] = ' ';
-			buf[bix++] = '.';
-			buf[bix++] = '\n';
+	if (UNLIKELY(!hdrp) && spfp == NULL) {
+		if (frmo && !magp) {
+			/* framed streams announce themselves once */
+			memcpy(buf + bix, FRAME_MAGIC, FRAME_MAGIC_LEN);
+			bix += FRAME_MAGIC_LEN;
+			magp = true;
 		}
+		/* time to push our prefixes in, later ones come as
+		 * directives of their own */
+		bix = wr_pres(&buf, &bsz, bix, cfd, false);
+		hdrp = true;
 	}
 
 	if (*s == '@') {
+		if (jobs != NULL) {
+			/* nothing may be out when prefixes change */
+			jobs_drain(ofd);
+		}
 		/* check if we haven't got this directive already */
-		if (add_prefix(s, z) > 0) {
+		switch (add_prefix(s, z)) {
+		case 1:
 			/* got him, skip */
 			return;
+		case 0:
+			if (spfp != NULL) {
+				/* goes into the header if used */
+				return;
+			}
+		default:
+			break;
 		}
 	}
 
-	if (UNLIKELY(bix + z + 3U/*\n*/ > bsz)) {
+	if (UNLIKELY(bix + z + 3U/*\n*/ + FRAME_HDRZ > bsz)) {
 		/* time to flush */
-		wr_buf(cfd, buf, bix);
+		wr_buf(ofd, buf, bix);
 		/* reset index pointer */
 		bix = 0U;
 
-		if (UNLIKELY(z + 2U/*\n*/ > bsz)) {
+		if (UNLIKELY(z + 3U/*\n*/ + FRAME_HDRZ > bsz)) {
 			/* resize :O */
-			RESZ(buf, bsz, next_2pow(z + 2U))
+			RESZ(buf, bsz, next_2pow(z + 3U + FRAME_HDRZ))
 			else {
 				return;
 			}
 		}
 	}
 
-	/* directives won't qualify as statements */
-	if (*s != '@') {
-		buf[bix++] = '\n';
-	}
-	/* copy */
-	memcpy(buf + bix, s, z);
-	/* finalise buffer */
-	buf[bix + z] = '\0';
-	/* and substitute, if it's not a @prefix */
-	if (*s != '@') {
-		z = subst(buf + bix, z);
+	if (jobs != NULL && *s != '@') {
+		/* hand it to the workers, the serial bits go first */
+		wr_buf(ofd, buf, bix);
+		bix = 0U;
+		jobs_add(ofd, s, z);
+		return;
 	}
-	/* append newline */
-	buf[bix += z] = '\n';
-	bix++;
+	bix += fmt_stmt(buf + bix, s, z, NULL);
 	return;
 }
 
 
 /* the actual splitting */
 static ssize_t
-proc(const char *buf, size_t bsz)
+proc(const char *buf, size_t bsz, bool lastp)
 {
 	const char *sp = buf;
-	const char *const UNUSED(ep) = buf + bsz;
-	enum {
-		FREE,
-		IN_ANGLES,
-		IN_QUOTES,
-		IN_LONG_QUOTES,
-		IN_COMMENT,
-	} st = FREE;
-
-#define fini_proc()	proc(NULL, 0U)
-	if (UNLIKELY(bsz == 0U)) {
+	const char *const ep = buf + bsz;
+	const char *bo;
+
+#define fini_proc()	proc(NULL, 0U, false)
+	if (UNLIKELY(buf == NULL)) {
 		/* and finalise */
 		fini_stmt();
-		st = FREE;
+		memset(&scn, 0, sizeof(scn));
 		return 0;
 	}
 
-next:
-	/* overread whitespace */
-	for (; *sp > '\0' && *sp <= ' '; sp++);
-
-	/* statements are always concluded by . so look for that guy */
-	for (const char *eo, *tp = sp;
-	     ({
-		     switch (st) {
-		     case FREE:
-			     eo = strpbrk(tp, ".<\"#");
-			     break;
-		     case IN_ANGLES:
-			     eo = strchr(tp, '>');
-			     break;
-		     case IN_QUOTES:
-			     eo = strchr(tp, '"');
-			     break;
-		     case IN_LONG_QUOTES:
-			     eo = strstr(tp, "\"\"\"");
-			     break;
-		     case IN_COMMENT:
-			     eo = strchr(tp, '\n');
-			     break;
-		     default:
-			     /* fuck */
-			     eo = NULL;
-			     break;
-		     }
-		     eo;
-	     }) != NULL; tp = eo) {
-		/* check character at point */
-		switch (*eo++) {
-		case '.':
-			wr_stmt(sp, eo - sp);
-			sp = eo;
-			goto next;
-		case '<':
-			/* find matching > */
-			st = IN_ANGLES;
-			break;
-		case '>':
-			/* yay, go back to free scan */
-			st = FREE;
-			break;
-		case '"':
-			/* skip this occurrence if it's an escaped " */
-			if (LIKELY(!escapedp(eo - 1, tp))) {
-				switch (st) {
-				case FREE:
-					/* check if it's a long quote (""") */
-					if (!eo[0U]) {
-						goto out;
-					} else if (eo[0U] != '"') {
-						st = IN_QUOTES;
-					} else if (!eo[1U]) {
-						goto out;
-					} else if (eo[1U] != '"') {
-						/* oh brill, we're through
-						 * already ... don't change
-						 * the state */
-						eo++;
-					} else {
-						st = IN_LONG_QUOTES;
-						eo += 2U;
-					}
-					break;
-				case IN_QUOTES:
-					st = FREE;
-					break;
-				case IN_LONG_QUOTES:
-					eo += 2U;
-					st = FREE;
-					break;
-				default:
-					/* huh? */
-					break;
-				}
+	for (const char *eo;
+	     (eo = (lastp ? scan_last : scan_stmt)(&scn, &bo, sp, ep)) != NULL;
+	     sp = eo) {
+		/* with --in-place everything before BO may be overwritten */
+		iprd = bo;
+		if (UNLIKELY(scn.dirp && *bo != '@')) {
+			/* turn sparql style directives into turtle ones */
+			char dir[4096U];
+			size_t z;
+
+			if ((z = scan_dir(dir, sizeof(dir), bo, eo - bo))) {
+				wr_stmt(dir, z);
 			}
-			break;
-		case '#':
-			assert(st == FREE);
-			st = IN_COMMENT;
-			break;
-		case '\n':
-			assert(st == IN_COMMENT);
-			st = FREE;
-			break;
-		default:
-			break;
+			continue;
 		}
+		wr_stmt(bo, eo - bo);
+	}
+	return bo - buf;
+}
+
+static ssize_t
+proc_frm(const char *buf, size_t bsz, bool lastp)
+{
+/* like proc() but for framed input */
+	const char *sp = buf;
+	const char *const ep = buf + bsz;
+	struct frame_s f;
+
+	if (UNLIKELY(frmi == 1)) {
+		sp += FRAME_MAGIC_LEN;
+		frmi = 2;
+	}
+	for (const char *eo; (eo = frame_get(&f, sp, ep)) != NULL; sp = eo) {
+		wr_stmt(f.s, f.z);
+	}
+	if (UNLIKELY(lastp && sp < ep)) {
+		errno = 0, error("Warning: input ends inside a frame");
 	}
-out:
 	return sp - buf;
 }
 
@@ -542,6 +1764,8 @@ split1(const char *fn)
 	char *buf = _buf;
 	size_t bsz = sizeof(_buf);
 	size_t bix;
+	/* bytes still to gather for discovery */
+	size_t smpz = autoz;
 	int fd;
 
 	if (fn == NULL) {
@@ -551,11 +1775,28 @@ split1(const char *fn)
 	}
 	/* read into buf */
 	bix = 0U;
+	frmi = -1;
 	for (ssize_t nrd, npr;
 	     (nrd = read(fd, buf + bix, bsz - bix - 1U/*\nul*/)) > 0;) {
 		/* mark the end of the buffer */
 		buf[bix += nrd] = '\0';
-		if ((npr = proc(buf, bix)) < 0) {
+		if (UNLIKELY(smpz) && bix < smpz) {
+			/* hold back till the sample is complete */
+			if (bix + 1U >= bsz) {
+				RESZ(buf, bsz, bsz << 1U)
+				else {
+					goto fuck;
+				}
+			}
+			continue;
+		} else if (UNLIKELY(smpz)) {
+			auto_pfx(buf, bix);
+			smpz = 0U;
+		}
+		if (UNLIKELY(frmi < 0) && (frmi = frame_magicp(buf, bix)) < 0) {
+			/* can't tell yet whether it's framed */
+			continue;
+		} else if ((npr = (frmi ? proc_frm : proc)(buf, bix, false)) < 0) {
 			goto fuck;
 		} else if (npr == 0 && bix + 1 >= bsz) {
 			/* need a bigger buffer */
@@ -571,10 +1812,14 @@ split1(const char *fn)
 			memmove(buf, buf + npr, bix);
 		}
 	}
+	if (UNLIKELY(smpz)) {
+		/* input's shorter than the sample */
+		auto_pfx(buf, bix);
+	}
 	/* finalise buffer again, just in case */
 	buf[bix] = '\0';
 	/* last try, we don't care how much gets processed */
-	(void)proc(buf, bix);
+	(void)(frmi > 0 ? proc_frm : proc)(buf, bix, true);
 	/* finalise processing */
 	fini_proc();
 
@@ -587,11 +1832,134 @@ fuck:
 	return 0;
 }
 
+static int
+range1(const char *fn)
+{
+	struct rmap_s r;
+
+	if (range_map(&r, fn, rng, false) < 0) {
+		if (errno == ESPIPE) {
+			errno = 0, error("Error: --range needs a regular file");
+		} else {
+			error("Error: cannot open file `%s'", fn);
+		}
+		return -1;
+	} else if (frame_magicp(r.m, r.mz) > 0) {
+		errno = 0, error("Error: --range needs turtle input");
+		range_unmap(&r);
+		return -1;
+	}
+	if (autoz && r.end > r.beg) {
+		const size_t z = r.end - r.beg;
+
+		auto_pfx(r.m + r.beg, z < autoz ? z : autoz);
+	}
+	if (r.hdrz) {
+		/* directives from the top of the file */
+		(void)proc(r.hdr, r.hdrz, true);
+	}
+	if (r.end > r.beg) {
+		(void)proc(r.m + r.beg, r.end - r.beg, true);
+	}
+	fini_proc();
+	range_unmap(&r);
+	return 0;
+}
+
+static int
+inpl1(const char *fn)
+{
+/* prefixify FN in place, output is written behind the read cursor */
+	struct stat st;
+	int rc = -1;
+
+	if ((ipfd = open(fn, O_RDWR)) < 0) {
+		error("Error: cannot open file `%s'", fn);
+		return -1;
+	} else if (fstat(ipfd, &st) < 0) {
+		error("Error: cannot stat file `%s'", fn);
+		goto fuck;
+	} else if (!S_ISREG(st.st_mode)) {
+		errno = 0, error("Error: --in-place needs a regular file");
+		goto fuck;
+	} else if (!(ipmz = st.st_size)) {
+		/* nothing to do */
+		rc = 0;
+		goto fuck;
+	}
+	ipm = mmap(NULL, ipmz, PROT_READ | PROT_WRITE, MAP_SHARED, ipfd, 0);
+	if (UNLIKELY(ipm == MAP_FAILED)) {
+		ipm = NULL;
+		error("Error: cannot map file `%s'", fn);
+		goto fuck;
+	} else if (frame_magicp(ipm, ipmz) > 0) {
+		errno = 0, error("Error: --in-place needs turtle input");
+		goto unm;
+	}
+
+	/* every file is an output of its own */
+	cfd = ipfd;
+	hdrp = magp = false;
+	iprd = ipm;
+	ipwr = 0U;
+	if (autoz) {
+		auto_pfx(ipm, ipmz < autoz ? ipmz : autoz);
+	}
+	(void)proc(ipm, ipmz, true);
+	iprd = ipm + ipmz;
+	fini_proc();
+	ip_flush();
+
+	rc = 0;
+	if (UNLIKELY(ipnpnd)) {
+		/* output's outgrown the input, append the rest */
+		if (pwrite(ipfd, ippnd, ipnpnd, ipwr) < (ssize_t)ipnpnd) {
+			error("Error: cannot write to `%s'", fn);
+			rc = -1;
+		}
+		ipwr += ipnpnd;
+		ipnpnd = 0U;
+	}
+	if (ftruncate(ipfd, ipwr) < 0) {
+		error("Error: cannot truncate `%s'", fn);
+		rc = -1;
+	}
+	cfd = STDOUT_FILENO;
+unm:
+	munmap(ipm, ipmz);
+	ipm = NULL;
+fuck:
+	close(ipfd);
+	ipfd = -1;
+	return rc;
+}
+
 
 #include "ttl-prefixify.yucc"
 
+static int
+set_dicts(const yuck_t argi[static 1U])
+{
+	if (argi->prefixes_arg && ld_prefixes(argi->prefixes_arg) < 0) {
+		error("Error: cannot load prefixes from `%s'", argi->prefixes_arg);
+		return -1;
+	}
+	if (udict != NULL) {
+		dicts[ndicts++] = udict;
+	}
+	if (argi->well_known_flag) {
+		dicts[ndicts++] = pfx_builtin;
+	}
+	return 0;
+}
+
+#if !defined RDFSNIPS
 int
 main(int argc, char *argv[])
+#else  /* RDFSNIPS */
+static int
+ttl_prefixify_main(int argc, char *argv[])
+#endif	/* !RDFSNIPS */
 {
 	yuck_t argi[1U];
 	size_t i = 0U;
@@ -602,17 +1970,250 @@ main(int argc, char *argv[])
 		goto out;
 	}
 
+	if (argi->range_arg) {
+		if (range_parse(&rng, argi->range_arg) < 0) {
+			errno = 0, error("\
+Error: cannot parse range `%s', must be START:END", argi->range_arg);
+			rc = 1;
+			goto out;
+		}
+		rngp = true;
+	}
+
+	if (set_dicts(argi) < 0) {
+		rc = 1;
+		goto out;
+	} else if (argi->compile_prefixes_flag) {
+		if (udict == NULL) {
+			errno = 0, error("\
+Error: --compile-prefixes needs --prefixes=FILE");
+			rc = 1;
+			goto out;
+		}
+		rc = wr_buf(STDOUT_FILENO, udict, udictz) < udictz;
+		goto out;
+	}
+
+	if (argi->auto_prefixes_arg == YUCK_OPTARG_NONE) {
+		autoz = 8U << 20U;
+	} else if (argi->auto_prefixes_arg) {
+		autoz = strtoul(argi->auto_prefixes_arg, NULL, 0) << 20U;
+	}
+
+	if (argi->jobs_arg &&
+	    init_jobs(strtoul(argi->jobs_arg, NULL, 0)) < 0) {
+		error("Error: cannot start worker threads");
+		rc = 1;
+		goto out;
+	}
+	if (argi->used_only_flag && (spfp = tmpfile()) == NULL) {
+		error("Error: cannot create spill file");
+		rc = 1;
+		goto out;
+	}
+
+	frmo = argi->emit_framed_flag;
+
+	if (argi->in_place_flag) {
+		if (rngp || !argi->nargs) {
+			errno = 0, error("\
+Error: --in-place needs FILEs and cannot be used with --range");
+			rc = 1;
+			goto out;
+		}
+		for (; i < argi->nargs; i++) {
+			rc -= inpl1(argi->args[i]);
+		}
+		goto out;
+	}
+
+	if (UNLIKELY((sob = make_obuf(STDOUT_FILENO, 0U, 0U)) == NULL)) {
+		error("Error: cannot set up output buffer");
+		rc = 1;
+		goto out;
+	}
 	if (argi->nargs == 0U) {
 		goto one;
 	}
 	for (; i < argi->nargs; i++) {
 	one:
-		rc -= split1(argi->args[i]);
+		rc -= !rngp ? split1(argi->args[i]) : range1(argi->args[i]);
 	}
 
 out:
+	fini_jobs();
+	if (sob != NULL) {
+		rc |= free_obuf(sob) < 0;
+		sob = NULL;
+	}
+	if (spfp != NULL) {
+		fclose(spfp);
+	}
+	free_dicts();
 	yuck_free(argi);
 	return rc;
 }
 
+#if defined RDFSNIPS
+/* as a stage of a fused pipeline */
+static yuck_t stg_argi[1U];
+static stage_stmt_f stg_nxt;
+
+static int
+stg_init(int argc, char *argv[], stage_stmt_f nxt, char ***args)
+{
+	int n;
+
+	if (yuck_parse(stg_argi, argc, argv) < 0) {
+		return -1;
+	} else if (stg_argi->range_arg) {
+		errno = 0, error("\
+Error: --range cannot be used in pipelines");
+		return -1;
+	} else if (stg_argi->emit_framed_flag && nxt != NULL) {
+		errno = 0, error("\
+Error: --emit-framed is for the last stage of a pipeline only");
+		return -1;
+	} else if (stg_argi->auto_prefixes_arg) {
+		errno = 0, error("\
+Error: --auto-prefixes cannot be used in pipelines");
+		return -1;
+	} else if (stg_argi->in_place_flag) {
+		errno = 0, error("\
+Error: --in-place cannot be used in pipelines");
+		return -1;
+	} else if (stg_argi->jobs_arg) {
+		errno = 0, error("\
+Error: -j cannot be used in pipelines");
+		return -1;
+	} else if (stg_argi->used_only_flag && nxt != NULL) {
+		errno = 0, error("\
+Error: --used-only is for the last stage of a pipeline only");
+		return -1;
+	} else if (stg_argi->used_only_flag && (spfp = tmpfile()) == NULL) {
+		error("Error: cannot create spill file");
+		return -1;
+	} else if (stg_argi->compile_prefixes_flag) {
+		errno = 0, error("\
+Error: --compile-prefixes cannot be used in pipelines");
+		return -1;
+	} else if (set_dicts(stg_argi) < 0) {
+		return -1;
+	} else if (nxt == NULL &&
+		   (sob = make_obuf(STDOUT_FILENO, 0U, 0U)) == NULL) {
+		error("Error: cannot set up output buffer");
+		return -1;
+	}
+	frmo = stg_argi->emit_framed_flag;
+	stg_nxt = nxt;
+	*args = stg_argi->args;
+	n = stg_argi->nargs;
+	stg_argi->nargs = 0U;
+	return n;
+}
+
+static void
+stg_pres(void)
+{
+/* hand our default prefixes to the next stage */
+	static const struct scan_s x = {.dirp = 1U};
+
+	for (size_t i = 0U; i < npres; i++) {
+		char dir[4096U];
+		size_t z;
+
+		z = snprintf(dir, sizeof(dir), "@prefix %.*s: <%.*s> .",
+			     (int)pres[i].prfx.len, pres[i].prfx.str,
+			     (int)pres[i].puri.len, pres[i].puri.str);
+		if (LIKELY(z < sizeof(dir))) {
+			stg_nxt(dir, z, &x);
+		}
+	}
+	return;
+}
+
+static void
+stg_stmt(const char *s, size_t z, const struct scan_s *x)
+{
+	static char _buf[4096U];
+	static char *buf = _buf;
+	static size_t bsz = sizeof(_buf);
+	static bool presp;
+
+	if (stg_nxt == NULL) {
+		/* we're the last stage, write it out */
+		wr_stmt(s, z);
+		return;
+	} else if (s == NULL) {
+		if (buf != _buf) {
+			munmap(buf, bsz);
+			buf = _buf;
+			bsz = sizeof(_buf);
+		}
+		return;
+	}
+
+	if (UNLIKELY(!presp)) {
+		stg_pres();
+		presp = true;
+	}
+	if (ndicts && !x->dirp) {
+		static const struct scan_s dirx = {.dirp = 1U};
+		char dir[4096U];
+
+		for (size_t dz, n; (dz = adopt(dir, sizeof(dir), s, z));) {
+			n = npres;
+			stg_stmt(dir, dz, &dirx);
+			if (UNLIKELY(npres <= n)) {
+				break;
+			}
+		}
+	}
+	if (x->dirp) {
+		if (*s == '@' && add_prefix(s, z) > 0) {
+			/* got him already */
+			return;
+		}
+		stg_nxt(s, z, x);
+		return;
+	}
+
+	if (UNLIKELY(z > bsz)) {
+		RESZ(buf, bsz, next_2pow(z))
+		else {
+			return;
+		}
+	}
+	z = subst(buf, s, z);
+	stg_nxt(buf, z, x);
+	return;
+}
+
+static int
+stg_fini(void)
+{
+	int rc = 0;
+
+	if (stg_nxt == NULL) {
+		fini_stmt();
+		rc = free_obuf(sob) < 0;
+		sob = NULL;
+	} else {
+		stg_stmt(NULL, 0U, NULL);
+		fini_prefix();
+	}
+	if (spfp != NULL) {
+		fclose(spfp);
+	}
+	free_dicts();
+	yuck_free(stg_argi);
+	return rc;
+}
+
+const struct stage_s stage_ttl_prefixify = {
+	"prefixify", "ttl-prefixify",
+	ttl_prefixify_main, stg_init, stg_stmt, stg_fini,
+};
+#endif	/* RDFSNIPS */
+
 /* ttl-prefixify.c ends here */
@@ -0,0 +1,198 @@
+/*** ttl-scan.c -- embeddable turtle statement scanner
+ *
+ * Copyright (C) 2026 Sebastian Freundt
+ *
+ * Author:  Sebastian Freundt <freundt@ga-group.nl>
+ *
+ * This file is part of rdfsnips.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the author nor the names of any contributors
+ *    may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED.  IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ ***/
+#if defined HAVE_CONFIG_H
+# include "config.h"
+#endif	/* HAVE_CONFIG_H */
+#include <stdlib.h>
+#include <string.h>
+#include "ttl-scan.h"
+#include "scan.h"
+#include "nifty.h"
+
+struct ttl_scan_s {
+	struct scan_s x;
+
+	ttl_scan_f cb;
+	void *clo;
+
+	/* stream offset of the next byte fed */
+	size_t off;
+
+	/* the statement begun but not finished by earlier feeds */
+	char *pnd;
+	size_t npnd;
+	size_t zpnd;
+	/* and its stream offset */
+	size_t opnd;
+};
+
+
+static int
+pnd_add(struct ttl_scan_s *c, const char *s, size_t z)
+{
+	if (UNLIKELY(c->npnd + z > c->zpnd)) {
+		size_t nuz = c->zpnd ?: 256U;
+		char *nup;
+
+		while (nuz < c->npnd + z) {
+			nuz <<= 1U;
+		}
+		if (UNLIKELY((nup = realloc(c->pnd, nuz)) == NULL)) {
+			return -1;
+		}
+		c->pnd = nup;
+		c->zpnd = nuz;
+	}
+	memcpy(c->pnd + c->npnd, s, z);
+	c->npnd += z;
+	return 0;
+}
+
+static int
+deliver(struct ttl_scan_s *c, const char *s, size_t z, size_t beg)
+{
+	struct ttl_stmt_s st = {
+		.s = s,
+		.z = z,
+		.beg = beg,
+		.end = beg + z,
+		.dirp = c->x.dirp,
+	};
+
+	if (!c->x.dirp) {
+		st.kind = TTL_STMT_TRIPLES;
+		st.npred = c->x.nsemi + 1U;
+		st.nobj = c->x.nsemi + c->x.ncomma + 1U;
+	} else {
+		/* @prefix and PREFIX vs @base and BASE */
+		const char k = s[*s == '@'];
+		st.kind = (k | 0x20) == 'p' ? TTL_STMT_PREFIX : TTL_STMT_BASE;
+	}
+	return c->cb(&st, c->clo);
+}
+
+
+ttl_scan_t
+make_ttl_scan(ttl_scan_f cb, void *clo)
+{
+	struct ttl_scan_s *r;
+
+	if (UNLIKELY((r = calloc(1, sizeof(*r))) == NULL)) {
+		return NULL;
+	}
+	r->cb = cb;
+	r->clo = clo;
+	return r;
+}
+
+void
+free_ttl_scan(ttl_scan_t c)
+{
+	free(c->pnd);
+	free(c);
+	return;
+}
+
+int
+ttl_scan_feed(ttl_scan_t c, const char *buf, size_t len)
+{
+	const char *sp = buf;
+	const char *const ep = buf + len;
+	const char *bo;
+	int rc = 0;
+
+	/* we keep unfinished statements ourselves,
+	 * a pending one simply continues at BUF */
+	c->x.pos = 0U;
+	for (const char *eo;
+	     (eo = scan_stmt(&c->x, &bo, sp, ep)) != NULL; sp = eo) {
+		if (UNLIKELY(c->npnd)) {
+			/* finish the statement from earlier feeds */
+			if (UNLIKELY(pnd_add(c, buf, eo - buf) < 0)) {
+				rc = -1;
+				break;
+			}
+			rc = deliver(c, c->pnd, c->npnd, c->opnd);
+			c->npnd = 0U;
+		} else {
+			rc = deliver(c, bo, eo - bo, c->off + (bo - buf));
+		}
+		if (UNLIKELY(rc)) {
+			break;
+		}
+	}
+	if (LIKELY(!rc) && bo < ep) {
+		/* keep the beginning of the next statement */
+		if (!c->npnd) {
+			c->opnd = c->off + (bo - buf);
+		}
+		rc = pnd_add(c, bo, ep - bo);
+	}
+	c->off += len;
+	return rc;
+}
+
+int
+ttl_scan_last(ttl_scan_t c)
+{
+	const char *bo;
+	int rc = 0;
+
+	c->x.pos = 0U;
+	if (!c->npnd) {
+		/* nothing begun */
+		;
+	} else if (scan_last(&c->x, &bo,
+			     c->pnd + c->npnd, c->pnd + c->npnd) != NULL) {
+		rc = deliver(c, c->pnd, c->npnd, c->opnd);
+	} else {
+		rc = -1;
+	}
+	/* ready for the next stream */
+	memset(&c->x, 0, sizeof(c->x));
+	c->npnd = 0U;
+	c->off = 0U;
+	return rc;
+}
+
+size_t
+ttl_scan_offset(ttl_scan_t c)
+{
+	return c->off;
+}
+
+/* ttl-scan.c ends here */
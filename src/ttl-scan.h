@@ -0,0 +1,130 @@
+/*** ttl-scan.h -- embeddable turtle statement scanner
+ *
+ * Copyright (C) 2026 Sebastian Freundt
+ *
+ * Author:  Sebastian Freundt <freundt@ga-group.nl>
+ *
+ * This file is part of rdfsnips.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the author nor the names of any contributors
+ *    may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED.  IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ ***/
+#if !defined INCLUDED_ttl_scan_h_
+#define INCLUDED_ttl_scan_h_
+#include <stddef.h>
+
+#if defined __cplusplus
+extern "C" {
+#endif	/* __cplusplus */
+
+/* Incremental statement scanner for turtle (and hence N-Triples).
+ *
+ * Input is pushed into a scanner context in buffers of arbitrary size,
+ * statements may straddle buffers.  For every complete statement the
+ * context's callback is invoked with the statement's text, its byte
+ * offsets in the input stream and what kind of statement it is.
+ * The scanner only finds statement boundaries, it does not validate
+ * or parse terms.
+ *
+ * Contexts are independent of each other, there's no global state,
+ * so any number of them can be used concurrently as long as each one
+ * is used by one thread at a time. */
+
+typedef struct ttl_scan_s *ttl_scan_t;
+
+typedef enum {
+	/* subject with predicates and objects */
+	TTL_STMT_TRIPLES,
+	/* @prefix or sparql style PREFIX */
+	TTL_STMT_PREFIX,
+	/* @base or sparql style BASE */
+	TTL_STMT_BASE,
+} ttl_stmt_kind_t;
+
+struct ttl_stmt_s {
+	/* statement text, up to and including the full stop of turtle
+	 * statements and directives, or the closing > of sparql style
+	 * directives, not \nul-terminated, valid during the callback */
+	const char *s;
+	size_t z;
+	/* byte offsets of the statement in the input stream,
+	 * [beg, end) so that end - beg == z */
+	size_t beg;
+	size_t end;
+
+	ttl_stmt_kind_t kind;
+	/* set for directives, i.e. kind != TTL_STMT_TRIPLES */
+	unsigned int dirp:1;
+
+	/* for triples statements the number of predicates and objects,
+	 * lists and blank node property lists count as single objects */
+	size_t npred;
+	size_t nobj;
+};
+
+/**
+ * Statement callback, CLO is the closure passed to make_ttl_scan().
+ * A non-0 return value stops the scanner and is passed on to the
+ * caller of ttl_scan_feed() or ttl_scan_last(). */
+typedef int(*ttl_scan_f)(const struct ttl_stmt_s *stmt, void *clo);
+
+/**
+ * Create a scanner context that calls CB with closure CLO for every
+ * statement.  Return NULL if out of memory. */
+extern ttl_scan_t make_ttl_scan(ttl_scan_f cb, void *clo);
+
+/**
+ * Free all resources associated with a scanner context. */
+extern void free_ttl_scan(ttl_scan_t);
+
+/**
+ * Push the LEN bytes in BUF into the scanner and call the callback for
+ * every statement completed by them.  Bytes of an unfinished statement
+ * are copied into the context, BUF is free for reuse upon return.
+ * Return 0 on success, -1 if out of memory or the callback's non-0
+ * return value.  Once a non-0 value has been returned the context
+ * should be reset with ttl_scan_last() before feeding it again. */
+extern int ttl_scan_feed(ttl_scan_t, const char *buf, size_t len);
+
+/**
+ * Signal the end of the input stream, a final statement whose full
+ * stop is the very last byte is delivered now.  Return 0 on success,
+ * the callback's non-0 return value, or -1 if the input ended inside
+ * a statement, which is then dropped.
+ * Afterwards the context is ready for a new stream at offset 0. */
+extern int ttl_scan_last(ttl_scan_t);
+
+/**
+ * Return the offset in the input stream of the next byte to be fed. */
+extern size_t ttl_scan_offset(ttl_scan_t);
+
+#if defined __cplusplus
+}
+#endif	/* __cplusplus */
+
+#endif	/* INCLUDED_ttl_scan_h_ */
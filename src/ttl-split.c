@@ -37,12 +37,41 @@
 #if defined HAVE_CONFIG_H
 # include "config.h"
 #endif	/* HAVE_CONFIG_H */
+#include <stdlib.h>
 #include <unistd.h>
 #include <stdbool.h>
 #include <sys/mman.h>
 #include <stdio.h>
 #include <string.h>
+#include <strings.h>
+#include <stdarg.h>
 #include <fcntl.h>
+#include <errno.h>
+#include <stdint.h>
+#include <limits.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <signal.h>
+#include <sys/stat.h>
+#include <poll.h>
+#include <time.h>
+#include <pthread.h>
+#if defined HAVE_ZLIB
+# include <zlib.h>
+#endif	/* HAVE_ZLIB */
+#if defined HAVE_ZSTD
+# include <zstd.h>
+#endif	/* HAVE_ZSTD */
+#include "pool.h"
+#include "obuf.h"
+#include "ttlidx.h"
+#include "term.h"
+#include "scan.h"
+#include "range.h"
+#include "frame.h"
+#if defined RDFSNIPS
+# include "stage.h"
+#endif	/* RDFSNIPS */
 #include "nifty.h"
 
 #if !defined MAP_ANON && defined MAP_ANONYMOUS
@@ -53,13 +82,120 @@
 #define PROT_RW		(PROT_READ | PROT_WRITE)
 #define MAP_MEM		(MAP_PRIVATE | MAP_ANON)
 
+#if !defined O_TMPFILE && defined __linux__
+# define O_TMPFILE	(020000000 | O_DIRECTORY)
+#endif	/* !O_TMPFILE */
+
 #define assert(x...)
 
 static size_t nstmt = 1000;
 static const char *prfx = "x";
+/* how many statements past nstmt a subject run may extend a chunk */
+static size_t slack;
+
+static enum {
+	COMP_NONE,
+	COMP_GZIP,
+	COMP_ZSTD,
+} comp;
+/* compression level, CLVL_DFLT for the method's default,
+ * note that 0 is a legit level for gzip */
+#define CLVL_DFLT	INT_MIN
+static int clvl = CLVL_DFLT;
+static pool_t cpool;
+
+/* split by predicate */
+static bool byp;
+
+/* filter command, and how many of them may run at once */
+static const char *filt;
+static size_t maxfilt = 1U;
+static size_t nfilt;
+static size_t nfilt_fail;
+
+/* chunks that couldn't be written, the compressors count too */
+static size_t nchnk_fail;
+static pthread_mutex_t fmtx = PTHREAD_MUTEX_INITIALIZER;
+
+/* follow mode, max latency in ms and time the current chunk got its
+ * first statement */
+static bool follow;
+static unsigned int maxlat = 1000U;
+static uint64_t cbeg;
+static volatile sig_atomic_t quitp;
+
+/* keep blank node groups together, window size in statements */
+static size_t bncw;
+/* number of chunks closed so far, and whether to hold off rotation */
+static size_t ncls;
+static bool holdp;
+
+/* buffer cap, statements that don't fit are streamed through */
+static size_t bcap = 256U * 1024U * 1024U;
+static enum {
+	STRM_NONE,
+	/* statement outgrew the buffer, nothing written yet */
+	STRM_BEG,
+	/* head has been written, more to come */
+	STRM_MORE,
+	/* the final bit */
+	STRM_END,
+} strm;
+/* offset of the streamed statement */
+static size_t strm_off;
+
+/* next chunk number */
+static size_t cstmt;
+/* index of the current input file, and offset past its last statement
+ * that's been scanned, for checkpoints */
+static size_t cfi;
+static size_t soff;
+
+/* statement index, if requested */
+static size_t istrd;
+static ttlidx_t sidx;
+/* file offset of the current scan buffer */
+static size_t ioff;
+
+/* scanner state */
+static struct scan_s scn;
+
+/* byte range to split, if requested */
+static struct range_s rng;
+static bool rngp;
+
+/* whether the input is framed, -1 for don't know yet,
+ * 1 if there's still the magic to skip */
+static int frmi;
 
 
 /* helpers */
+static void
+__attribute__((format(printf, 1, 2)))
+error(const char *fmt, ...)
+{
+	va_list vap;
+	va_start(vap, fmt);
+	vfprintf(stderr, fmt, vap);
+	va_end(vap);
+	if (errno) {
+		fputc(':', stderr);
+		fputc(' ', stderr);
+		fputs(strerror(errno), stderr);
+	}
+	fputc('\n', stderr);
+	return;
+}
+
+static uint64_t
+now_ms(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000ULL + ts.tv_nsec / 1000000ULL;
+}
+
 static __attribute__((const, pure)) size_t
 next_2pow(size_t x)
 {
@@ -72,6 +208,19 @@ next_2pow(size_t x)
 	return ++x;
 }
 
+static __attribute__((pure)) uint64_t
+hash_str(const char *s, size_t z)
+{
+	/* FNV-1a */
+	uint64_t h = 0xcbf29ce484222325ULL;
+
+	for (size_t i = 0U; i < z; i++) {
+		h ^= (unsigned char)s[i];
+		h *= 0x100000001b3ULL;
+	}
+	return h;
+}
+
 static void*
 resz(void *buf, size_t old, size_t new)
 {
@@ -92,20 +241,6 @@ resz(void *buf, size_t old, size_t new)
 		_oz = _nuz_;						\
 	}
 
-static inline bool
-escapedp(const char *sp, const char *bp)
-{
-/* find out if sp is backslash-escaped
- * but backslash-escaped backslashes won't count,
- * so make sure the number of backslashes before sp is odd */
-	int bksl = 0;
-
-	while (sp-- > bp && *sp == '\\') {
-		bksl ^= 1;
-	}
-	return bksl;
-}
-
 static size_t
 wr_buf(int fd, const char *buf, size_t bsz)
 {
@@ -118,230 +253,2000 @@ wr_buf(int fd, const char *buf, size_t bsz)
 	return tot;
 }
 
+
+/* checkpoints
+ * once a chunk is finished, i.e. written, compressed, or its filter
+ * exited successfully, the manifest is rewritten with the input offset
+ * past the chunk's last statement, the number of the next chunk and
+ * the directives in effect; chunks may finish out of order, so the
+ * manifest only ever covers an unbroken run of finished chunks */
+struct ckpt_s {
+	size_t cno;
+	pid_t pid;
+	/* set when the chunk has been closed */
+	bool clsp;
+	/* set when the chunk's file is complete */
+	bool donep;
+	size_t fi;
+	size_t off;
+	char *dir;
+	size_t dz;
+};
+
+/* manifest file name, NULL when not checkpointing */
+static const char *ckfn;
+/* input file names as given on the command line */
+static char *const *ckin;
+static size_t nckin;
+/* pending chunks, ordered by chunk number */
+static struct ckpt_s *ckq;
+static size_t nckq;
+static size_t zckq;
+static pthread_mutex_t ckmtx = PTHREAD_MUTEX_INITIALIZER;
+/* resumption point, consumed by the first input */
+static bool rsmp;
+static size_t rsm_off;
+static char *rsm_dir;
+static size_t rsm_dz;
+
+static int
+ckpt_wr(const struct ckpt_s *k)
+{
+	char tmp[4096U];
+	char hdr[4096U + 256U];
+	size_t z;
+	int fd;
+
+	snprintf(tmp, sizeof(tmp), "%s.tmp", ckfn);
+	if (UNLIKELY((fd = open(tmp, O_CREAT | O_TRUNC | O_WRONLY, 0666)) < 0)) {
+		error("Error: cannot write manifest `%s'", tmp);
+		return -1;
+	}
+	z = snprintf(hdr, sizeof(hdr), "\
+ttl-split manifest 1\n\
+input %zu %s\n\
+offset %zu\n\
+chunk %zu\n\
+dirhash %016llx\n\
+dirsize %zu\n",
+		     k->fi, k->fi < nckin ? ckin[k->fi] : "-",
+		     k->off, k->cno + 1U,
+		     (unsigned long long)hash_str(k->dir, k->dz), k->dz);
+	wr_iov(fd, (struct iovec[]){
+			{hdr, z},
+			{k->dir, k->dz},
+		}, 2);
+	/* the manifest must be on disk before it replaces the old one */
+	fdatasync(fd);
+	close(fd);
+	return rename(tmp, ckfn);
+}
+
 static void
-wr_stmt(const char *s, size_t z)
+ckpt_pub(void)
 {
-	static char _buf[4096U];
-	static char *buf = _buf;
-	static size_t bsz = sizeof(_buf);
-	static size_t bix = 0U;
-	static char _dir[4096U];
-	static char *dir = _dir;
-	static size_t dsz = sizeof(_dir);
-	static size_t dix = 0U;
-	static size_t istmt;
-	static size_t cstmt;
-	static int cfd = -1;
+/* pop finished chunks off the queue and write the manifest for the
+ * last of them, call with ckmtx held */
+	size_t i;
+
+	for (i = 0U; i < nckq && ckq[i].clsp && ckq[i].donep; i++);
+	if (!i) {
+		return;
+	}
+	ckpt_wr(ckq + i - 1U);
+	for (size_t j = 0U; j < i; j++) {
+		free(ckq[j].dir);
+	}
+	memmove(ckq, ckq + i, (nckq -= i) * sizeof(*ckq));
+	return;
+}
+
+static void
+ckpt_opn(size_t cno, pid_t pid)
+{
+	pthread_mutex_lock(&ckmtx);
+	if (UNLIKELY(nckq >= zckq)) {
+		const size_t nuz = zckq ? zckq << 1U : 64U;
+		struct ckpt_s *nuq = realloc(ckq, nuz * sizeof(*nuq));
+
+		if (UNLIKELY(nuq == NULL)) {
+			goto out;
+		}
+		ckq = nuq;
+		zckq = nuz;
+	}
+	ckq[nckq++] = (struct ckpt_s){.cno = cno, .pid = pid};
+out:
+	pthread_mutex_unlock(&ckmtx);
+	return;
+}
+
+static void
+ckpt_cls(size_t fi, size_t off, const char *dir, size_t dz)
+{
+/* fill in the most recently opened chunk */
+	pthread_mutex_lock(&ckmtx);
+	if (LIKELY(nckq)) {
+		struct ckpt_s *k = ckq + nckq - 1U;
+
+		if (LIKELY((k->dir = malloc(dz + 1U)) != NULL)) {
+			memcpy(k->dir, dir, k->dz = dz);
+		}
+		k->fi = fi;
+		k->off = off;
+		k->clsp = true;
+		ckpt_pub();
+	}
+	pthread_mutex_unlock(&ckmtx);
+	return;
+}
+
+static void
+ckpt_done(size_t cno, pid_t pid)
+{
+/* mark chunk CNO, or the one whose filter is PID, as finished */
+	pthread_mutex_lock(&ckmtx);
+	for (size_t i = 0U; i < nckq; i++) {
+		if (pid ? ckq[i].pid == pid : ckq[i].cno == cno) {
+			ckq[i].donep = true;
+			ckpt_pub();
+			break;
+		}
+	}
+	pthread_mutex_unlock(&ckmtx);
+	return;
+}
+
+static int
+ckpt_skip(int fd, size_t off)
+{
+/* advance FD by OFF bytes, pipes have to be read off */
+	char b[65536U];
+
+	if (lseek(fd, off, SEEK_CUR) >= 0) {
+		return 0;
+	} else if (errno != ESPIPE) {
+		return -1;
+	}
+	for (ssize_t nrd; off; off -= nrd) {
+		if ((nrd = read(fd, b, off < sizeof(b) ? off : sizeof(b))) <= 0) {
+			return -1;
+		}
+	}
+	return 0;
+}
+
+static void
+free_ckpt(void)
+{
+	for (size_t i = 0U; i < nckq; i++) {
+		free(ckq[i].dir);
+	}
+	free(ckq);
+	free(rsm_dir);
+	return;
+}
+
+static char*
+ckpt_rd(size_t *fi, size_t *off, size_t *cno, size_t *dz)
+{
+/* read manifest, return its directive block */
+	char fn[4096U];
+	unsigned long long h;
+	struct stat st;
+	char *m = NULL;
+	int n = 0;
+	int fd;
+
+	if (UNLIKELY((fd = open(ckfn, O_RDONLY)) < 0)) {
+		error("Error: cannot open manifest `%s'", ckfn);
+		return NULL;
+	} else if (UNLIKELY(fstat(fd, &st) < 0)) {
+		goto fuck;
+	} else if (UNLIKELY((m = malloc(st.st_size + 1U)) == NULL)) {
+		goto fuck;
+	} else if (read(fd, m, st.st_size) != st.st_size) {
+		goto fuck;
+	}
+	m[st.st_size] = '\0';
+	if (sscanf(m, "\
+ttl-split manifest 1\n\
+input %zu %4095[^\n]\n\
+offset %zu\n\
+chunk %zu\n\
+dirhash %llx\n\
+dirsize %zu\n%n", fi, fn, off, cno, &h, dz, &n) < 6 || !n ||
+	    *dz > (size_t)st.st_size - n || hash_str(m + n, *dz) != h) {
+		errno = 0, error("Error: manifest `%s' is corrupt", ckfn);
+		goto fuck;
+	} else if (*fi >= (nckin ?: 1U) ||
+		   strcmp(fn, *fi < nckin ? ckin[*fi] : "-")) {
+		errno = 0, error("\
+Error: manifest `%s' refers to input `%s'", ckfn, fn);
+		goto fuck;
+	}
+	close(fd);
+	memmove(m, m + n, *dz);
+	return m;
+
+fuck:
+	free(m);
+	close(fd);
+	return NULL;
+}
+
+
+
+/* chunk sinks
+ * uncompressed chunks go straight to disk, compressed chunks are
+ * collected in memory and handed to the compressor pool when full,
+ * unless they get an oversized statement, see zs_chnk() */
+struct chnk_s {
+	char *buf;
+	size_t bsz;
+	size_t bix;
+	size_t cno;
+	/* compressor if compressing on the fly */
+	struct zsnk_s *zs;
+	char fn[];
+};
+
+static const char *const cext[] = {
+	[COMP_NONE] = "",
+	[COMP_GZIP] = ".gz",
+	[COMP_ZSTD] = ".zst",
+};
+
+static int cfd = -1;
+static char cfn[4096U];
+static size_t ccno;
+/* errno of the first failure to open or write CFD */
+static int cerr;
+static struct chnk_s *cchk;
+/* pid of the current filter */
+static pid_t cpid;
+
+/* compressing sinks, usually a whole chunk is compressed in one go
+ * on the pool but chunks with oversized statements are compressed on
+ * the fly so the chunk needn't be held in memory */
+struct zsnk_s {
+	int fd;
+	/* set once compressing or writing has failed */
+	bool errp;
+#if defined HAVE_ZLIB
+	z_stream z;
+#endif	/* HAVE_ZLIB */
+#if defined HAVE_ZSTD
+	ZSTD_CCtx *cx;
+#endif	/* HAVE_ZSTD */
+};
+
+static int
+zsnk_init(struct zsnk_s *restrict k, int fd)
+{
+	k->fd = fd;
+	k->errp = false;
+	switch (comp) {
+#if defined HAVE_ZLIB
+	case COMP_GZIP:
+		k->z = (z_stream){NULL};
+		/* windowBits + 16 gets us gzip headers */
+		if (deflateInit2(&k->z,
+				 clvl != CLVL_DFLT ? clvl : Z_DEFAULT_COMPRESSION,
+				 Z_DEFLATED, 15 + 16, 8,
+				 Z_DEFAULT_STRATEGY) != Z_OK) {
+			return -1;
+		}
+		return 0;
+#endif	/* HAVE_ZLIB */
+#if defined HAVE_ZSTD
+	case COMP_ZSTD:
+		if (UNLIKELY((k->cx = ZSTD_createCCtx()) == NULL)) {
+			return -1;
+		} else if (clvl != CLVL_DFLT) {
+			(void)ZSTD_CCtx_setParameter(
+				k->cx, ZSTD_c_compressionLevel, clvl);
+		}
+		return 0;
+#endif	/* HAVE_ZSTD */
+	default:
+		break;
+	}
+	return -1;
+}
+
+static void
+zsnk_wr(struct zsnk_s *restrict k, const char *buf, size_t bsz, bool finp)
+{
+/* compress BUF and write it out, FINP finishes the stream */
+	switch (comp) {
+#if defined HAVE_ZLIB
+	case COMP_GZIP: {
+		unsigned char out[65536U];
+
+		do {
+			/* avail_in is only a uInt */
+			const size_t nin =
+				bsz < (1U << 30U) ? bsz : (1U << 30U);
+
+			k->z.next_in = deconst(buf);
+			k->z.avail_in = nin;
+			buf += nin;
+			bsz -= nin;
+			do {
+				size_t nout;
+
+				k->z.next_out = out;
+				k->z.avail_out = sizeof(out);
+				if (UNLIKELY(deflate(&k->z, bsz || !finp
+						     ? Z_NO_FLUSH : Z_FINISH)
+					     == Z_STREAM_ERROR)) {
+					k->errp = true;
+					return;
+				}
+				nout = sizeof(out) - k->z.avail_out;
+				k->errp |= wr_buf(k->fd, (char*)out, nout) < nout;
+			} while (k->z.avail_out == 0U);
+		} while (bsz);
+		break;
+	}
+#endif	/* HAVE_ZLIB */
+#if defined HAVE_ZSTD
+	case COMP_ZSTD: {
+		char out[65536U];
+		ZSTD_inBuffer i = {buf, bsz, 0U};
+
+		for (size_t rem;;) {
+			ZSTD_outBuffer o = {out, sizeof(out), 0U};
+
+			rem = ZSTD_compressStream2(
+				k->cx, &o, &i,
+				finp ? ZSTD_e_end : ZSTD_e_continue);
+			if (UNLIKELY(ZSTD_isError(rem))) {
+				k->errp = true;
+				break;
+			}
+			k->errp |= wr_buf(k->fd, out, o.pos) < o.pos;
+			if (finp ? !rem : i.pos >= i.size) {
+				break;
+			}
+		}
+		break;
+	}
+#endif	/* HAVE_ZSTD */
+	default:
+		break;
+	}
+	return;
+}
+
+static void
+zsnk_fini(struct zsnk_s *restrict k)
+{
+	switch (comp) {
+#if defined HAVE_ZLIB
+	case COMP_GZIP:
+		deflateEnd(&k->z);
+		break;
+#endif	/* HAVE_ZLIB */
+#if defined HAVE_ZSTD
+	case COMP_ZSTD:
+		ZSTD_freeCCtx(k->cx);
+		break;
+#endif	/* HAVE_ZSTD */
+	default:
+		break;
+	}
+	return;
+}
+
+static int
+opn_pub(const char *fn)
+{
+/* open FN for writing, when following files are created anonymously
+ * (or under a temporary name) and only published by cls_pub() */
+	const int fl = O_CREAT | O_TRUNC | O_WRONLY;
+	char tmp[4096U];
+
+	if (!follow) {
+		return open(fn, fl, 0666);
+	}
+#if defined O_TMPFILE
+	with (const char *sl = strrchr(fn, '/')) {
+		int fd;
+
+		if (sl == NULL) {
+			tmp[0U] = '.', tmp[1U] = '\0';
+		} else {
+			const size_t dz = sl > fn ? sl - fn : 1U;
+
+			memcpy(tmp, fn, dz);
+			tmp[dz] = '\0';
+		}
+		if ((fd = open(tmp, O_TMPFILE | O_WRONLY, 0666)) >= 0) {
+			return fd;
+		}
+	}
+#endif	/* O_TMPFILE */
+	snprintf(tmp, sizeof(tmp), "%s.tmp", fn);
+	return open(tmp, fl, 0666);
+}
+
+static int
+cls_pub(int fd, const char *fn)
+{
+	struct stat st;
+	char tmp[4096U];
+
+	if (!follow) {
+		return close(fd);
+	} else if (fstat(fd, &st) < 0) {
+		close(fd);
+		return -1;
+	} else if (st.st_nlink) {
+		/* must be our fallback, rename then */
+		close(fd);
+		snprintf(tmp, sizeof(tmp), "%s.tmp", fn);
+		return rename(tmp, fn);
+	}
+	/* anonymous file, link it in */
+	snprintf(tmp, sizeof(tmp), "/proc/self/fd/%d", fd);
+	if (linkat(AT_FDCWD, tmp, AT_FDCWD, fn, AT_SYMLINK_FOLLOW) < 0 &&
+	    (errno != EEXIST || unlink(fn) < 0 ||
+	     linkat(AT_FDCWD, tmp, AT_FDCWD, fn, AT_SYMLINK_FOLLOW) < 0)) {
+		error("Error: cannot publish `%s'", fn);
+		close(fd);
+		return -1;
+	}
+	return close(fd);
+}
+
+static void
+fail_chnk(const char *fn)
+{
+/* report chunk FN as not written, the compressors call this too */
+	error("Error: cannot write `%s'", fn);
+	pthread_mutex_lock(&fmtx);
+	nchnk_fail++;
+	pthread_mutex_unlock(&fmtx);
+	return;
+}
+
+static void
+comp_chnk(void *clo)
+{
+/* runs on the compressor pool */
+	struct chnk_s *c = clo;
+	struct zsnk_s k;
+	int fd;
+
+	if (UNLIKELY((fd = opn_pub(c->fn)) < 0)) {
+		fail_chnk(c->fn);
+	} else if (UNLIKELY(zsnk_init(&k, fd) < 0)) {
+		errno = 0;
+		fail_chnk(c->fn);
+		close(fd);
+	} else {
+		zsnk_wr(&k, c->buf, c->bix, true);
+		zsnk_fini(&k);
+		if (UNLIKELY(k.errp)) {
+			fail_chnk(c->fn);
+			close(fd);
+		} else if (UNLIKELY(cls_pub(fd, c->fn) < 0)) {
+			fail_chnk(c->fn);
+		} else if (ckfn != NULL) {
+			ckpt_done(c->cno, 0);
+		}
+	}
+	if (c->buf != NULL) {
+		munmap(c->buf, c->bsz);
+	}
+	free(c);
+	return;
+}
+
+static void
+reap_filt(bool blockp)
+{
+	for (int st; nfilt > 0U; nfilt--) {
+		pid_t p = waitpid(-1, &st, blockp ? 0 : WNOHANG);
+
+		if (p <= 0) {
+			break;
+		} else if (!WIFEXITED(st) || WEXITSTATUS(st)) {
+			nfilt_fail++;
+		} else if (ckfn != NULL) {
+			ckpt_done(0U, p);
+		}
+		/* one slot is all we need unless told otherwise */
+		blockp = false;
+	}
+	return;
+}
+
+static int
+opn_filt(const char *fn)
+{
+/* spawn filter with $FILE set to FN, return the write end of its stdin */
+	int pfd[2U];
+	pid_t p;
+
+	/* don't run more than MAXFILT at once */
+	reap_filt(false);
+	while (nfilt >= maxfilt) {
+		reap_filt(true);
+	}
+	if (UNLIKELY(pipe(pfd) < 0)) {
+		return -1;
+	}
+	switch ((p = fork())) {
+	case -1:
+		close(pfd[0U]);
+		close(pfd[1U]);
+		return -1;
+	case 0:
+		/* child */
+		close(pfd[1U]);
+		if (pfd[0U] != STDIN_FILENO) {
+			dup2(pfd[0U], STDIN_FILENO);
+			close(pfd[0U]);
+		}
+		setenv("FILE", fn, 1);
+		execl("/bin/sh", "sh", "-c", filt, (char*)NULL);
+		_exit(127);
+	default:
+		break;
+	}
+	close(pfd[0U]);
+	/* don't leak this into the next filter */
+	(void)fcntl(pfd[1U], F_SETFD, FD_CLOEXEC);
+	cpid = p;
+	nfilt++;
+	return pfd[1U];
+}
+
+static int
+opn_chnk(size_t cno)
+{
+	char fn[4096U];
+	size_t fz;
+
+	fz = snprintf(fn, sizeof(fn), "%s%04zu%s", prfx, cno, cext[comp]);
+	ccno = cno;
+	if (filt != NULL) {
+		if ((cfd = opn_filt(fn)) >= 0 && ckfn != NULL) {
+			ckpt_opn(cno, cpid);
+		}
+		return cfd;
+	} else if (!comp) {
+		memcpy(cfn, fn, fz + 1U);
+		if (UNLIKELY((cfd = opn_pub(fn)) < 0)) {
+			/* carry on, cls_chnk() reports it once per chunk */
+			cerr = errno;
+			return 0;
+		} else if (ckfn != NULL) {
+			ckpt_opn(cno, 0);
+		}
+		cerr = 0;
+		return cfd;
+	} else if (UNLIKELY((cchk = malloc(sizeof(*cchk) + ++fz)) == NULL)) {
+		fail_chnk(fn);
+		return -1;
+	}
+	cchk->buf = NULL;
+	cchk->bsz = 0U;
+	cchk->bix = 0U;
+	cchk->cno = cno;
+	cchk->zs = NULL;
+	memcpy(cchk->fn, fn, fz);
+	if (ckfn != NULL) {
+		ckpt_opn(cno, 0);
+	}
+	return 0;
+}
+
+static void
+zs_chnk(void)
+{
+/* switch the current chunk to compressing on the fly, so that a
+ * statement beyond the buffer cap needn't be held in memory */
+	struct zsnk_s *k;
+	int fd;
+
+	if (UNLIKELY((k = malloc(sizeof(*k))) == NULL)) {
+		return;
+	} else if (UNLIKELY((fd = opn_pub(cchk->fn)) < 0)) {
+		/* keep buffering, the compressor will fail and say so */
+		free(k);
+		return;
+	} else if (UNLIKELY(zsnk_init(k, fd) < 0)) {
+		close(fd);
+		free(k);
+		return;
+	}
+	/* what's been collected so far goes first */
+	if (cchk->buf != NULL) {
+		zsnk_wr(k, cchk->buf, cchk->bix, false);
+		munmap(cchk->buf, cchk->bsz);
+		cchk->buf = NULL;
+		cchk->bsz = 0U;
+		cchk->bix = 0U;
+	}
+	cchk->zs = k;
+	return;
+}
+
+static void
+wr_chnk(const char *buf, size_t bsz)
+{
+	if (!comp) {
+		/* wr_stmt() hands us whole buffers, no need to buffer again */
+		if (UNLIKELY(wr_buf(cfd, buf, bsz) < bsz) && !cerr) {
+			cerr = errno ?: EIO;
+		}
+		return;
+	} else if (UNLIKELY(strm) && cchk->zs == NULL) {
+		zs_chnk();
+	}
+	if (UNLIKELY(cchk->zs != NULL)) {
+		zsnk_wr(cchk->zs, buf, bsz, false);
+		return;
+	} else if (UNLIKELY(cchk->bix + bsz > cchk->bsz)) {
+		size_t nuz = next_2pow(cchk->bix + bsz);
+		char *nub;
+
+		if (nuz < 65536U) {
+			nuz = 65536U;
+		}
+		nub = mmap(NULL, nuz, PROT_RW, MAP_MEM, -1, 0);
+		if (UNLIKELY(nub == MAP_FAILED)) {
+			return;
+		}
+		if (cchk->buf != NULL) {
+			memcpy(nub, cchk->buf, cchk->bix);
+			munmap(cchk->buf, cchk->bsz);
+		}
+		cchk->buf = nub;
+		cchk->bsz = nuz;
+	}
+	memcpy(cchk->buf + cchk->bix, buf, bsz);
+	cchk->bix += bsz;
+	return;
+}
+
+static void
+cls_chnk(void)
+{
+	if (filt != NULL) {
+		close(cfd);
+		cfd = -1;
+		return;
+	} else if (!comp) {
+		if (UNLIKELY(cerr)) {
+			errno = cerr;
+			fail_chnk(cfn);
+			if (cfd >= 0) {
+				close(cfd);
+			}
+		} else if (UNLIKELY(cls_pub(cfd, cfn) < 0)) {
+			fail_chnk(cfn);
+		} else if (ckfn != NULL) {
+			ckpt_done(ccno, 0);
+		}
+		cfd = -1;
+		return;
+	}
+	if (UNLIKELY(cchk->zs != NULL)) {
+		/* compressed on the fly, finish it here */
+		zsnk_wr(cchk->zs, NULL, 0U, true);
+		zsnk_fini(cchk->zs);
+		if (UNLIKELY(cchk->zs->errp)) {
+			fail_chnk(cchk->fn);
+			close(cchk->zs->fd);
+		} else if (UNLIKELY(cls_pub(cchk->zs->fd, cchk->fn) < 0)) {
+			fail_chnk(cchk->fn);
+		} else if (ckfn != NULL) {
+			ckpt_done(cchk->cno, 0);
+		}
+		free(cchk->zs);
+		free(cchk);
+		cchk = NULL;
+		return;
+	}
+	/* the pool owns the chunk now */
+	pool_push(cpool, comp_chnk, cchk);
+	cchk = NULL;
+	return;
+}
+
+
+/* vertical partitioning
+ * every predicate gets its own output stream, streams are buffered
+ * and only a limited number of them keep their files open, the least
+ * recently used one is closed when we run out */
+#define PBUF_MIN	(4096U)
+#define PBUF_MAX	(262144U)
+#define PBUF_BUDGET	(256U * 1024U * 1024U)
+
+struct pstr_s {
+	char *p;
+	size_t pz;
+	char *buf;
+	size_t bsz;
+	size_t bix;
+	/* how much of the directive block this stream has seen */
+	size_t dix;
+	int fd;
+	bool creatp;
+	/* lru links, indices into PSTR */
+	size_t prev;
+	size_t next;
+};
+
+#define PSTR_NIL	((size_t)-1)
+
+static struct pstr_s *pstr;
+static size_t npstr;
+static size_t zpstr;
+/* hash table of stream indices + 1 */
+static size_t *phtb;
+static size_t zphtb;
+/* lru list of streams with open files, head is most recent */
+static size_t lru_hd = PSTR_NIL;
+static size_t lru_tl = PSTR_NIL;
+static size_t nopen;
+static size_t maxopen;
+/* total buffer memory */
+static size_t pbuf_tot;
+/* directives seen so far */
+static char *pdir;
+static size_t pdix;
+static size_t pdsz;
+
+static void
+lru_unlink(size_t i)
+{
+	struct pstr_s *p = pstr + i;
+
+	if (p->prev != PSTR_NIL) {
+		pstr[p->prev].next = p->next;
+	} else {
+		lru_hd = p->next;
+	}
+	if (p->next != PSTR_NIL) {
+		pstr[p->next].prev = p->prev;
+	} else {
+		lru_tl = p->prev;
+	}
+	p->prev = p->next = PSTR_NIL;
+	return;
+}
+
+static void
+lru_push(size_t i)
+{
+	struct pstr_s *p = pstr + i;
+
+	p->prev = PSTR_NIL;
+	p->next = lru_hd;
+	if (lru_hd != PSTR_NIL) {
+		pstr[lru_hd].prev = i;
+	} else {
+		lru_tl = i;
+	}
+	lru_hd = i;
+	return;
+}
+
+static int
+pstr_fd(size_t i)
+{
+	struct pstr_s *p = pstr + i;
+
+	if (p->fd >= 0) {
+		/* bump him */
+		if (lru_hd != i) {
+			lru_unlink(i);
+			lru_push(i);
+		}
+		return p->fd;
+	}
+	if (nopen >= maxopen && lru_tl != PSTR_NIL) {
+		/* evict least recently used */
+		size_t j = lru_tl;
+
+		lru_unlink(j);
+		close(pstr[j].fd);
+		pstr[j].fd = -1;
+		nopen--;
+	}
+	with (char fn[4096U]) {
+		int fl = O_WRONLY;
+
+		fl |= !p->creatp ? O_CREAT | O_TRUNC : O_APPEND;
+		snprintf(fn, sizeof(fn), "%s%04zu", prfx, i);
+		if (UNLIKELY((p->fd = open(fn, fl, 0666)) < 0)) {
+			error("Error: cannot open `%s'", fn);
+			return -1;
+		}
+	}
+	p->creatp = true;
+	lru_push(i);
+	nopen++;
+	return p->fd;
+}
+
+static void
+pstr_flush(size_t i)
+{
+	struct pstr_s *p = pstr + i;
+	int fd;
+
+	if (!p->bix || (fd = pstr_fd(i)) < 0) {
+		return;
+	}
+	wr_buf(fd, p->buf, p->bix);
+	p->bix = 0U;
+	return;
+}
+
+static void
+pstr_add(size_t i, const char *s, size_t z)
+{
+	struct pstr_s *p = pstr + i;
+
+	if (UNLIKELY(p->bix + z > p->bsz)) {
+		size_t nuz = p->bsz ?: PBUF_MIN;
+
+		for (; nuz < p->bix + z && nuz < PBUF_MAX; nuz <<= 1U);
+		if (nuz > p->bsz && pbuf_tot + nuz - p->bsz <= PBUF_BUDGET) {
+			char *nub = realloc(p->buf, nuz);
+
+			if (LIKELY(nub != NULL)) {
+				pbuf_tot += nuz - p->bsz;
+				p->buf = nub;
+				p->bsz = nuz;
+			}
+		}
+	}
+	if (UNLIKELY(p->bix + z > p->bsz)) {
+		pstr_flush(i);
+		if (z > p->bsz) {
+			/* write through */
+			int fd = pstr_fd(i);
+
+			if (LIKELY(fd >= 0)) {
+				wr_buf(fd, s, z);
+			}
+			return;
+		}
+	}
+	memcpy(p->buf + p->bix, s, z);
+	p->bix += z;
+	return;
+}
+
+static size_t
+pstr_get(const char *s, size_t z)
+{
+	const uint64_t h = hash_str(s, z);
+	size_t k;
+
+	if (UNLIKELY(2U * npstr >= zphtb)) {
+		/* rehash */
+		const size_t nuz = zphtb ? zphtb << 1U : 1024U;
+		size_t *nuh = calloc(nuz, sizeof(*nuh));
+
+		if (UNLIKELY(nuh == NULL)) {
+			return PSTR_NIL;
+		}
+		for (size_t j = 0U; j < npstr; j++) {
+			const uint64_t hj = hash_str(pstr[j].p, pstr[j].pz);
+
+			for (k = hj & (nuz - 1U); nuh[k]; k = (k + 1U) & (nuz - 1U));
+			nuh[k] = j + 1U;
+		}
+		free(phtb);
+		phtb = nuh;
+		zphtb = nuz;
+	}
+	for (k = h & (zphtb - 1U); phtb[k]; k = (k + 1U) & (zphtb - 1U)) {
+		const struct pstr_s *p = pstr + phtb[k] - 1U;
+
+		if (p->pz == z && !memcmp(p->p, s, z)) {
+			return phtb[k] - 1U;
+		}
+	}
+	/* new stream then */
+	if (UNLIKELY(npstr >= zpstr)) {
+		const size_t nuz = zpstr ? zpstr << 1U : 256U;
+		struct pstr_s *nup = realloc(pstr, nuz * sizeof(*nup));
+
+		if (UNLIKELY(nup == NULL)) {
+			return PSTR_NIL;
+		}
+		pstr = nup;
+		zpstr = nuz;
+	}
+	with (struct pstr_s *p = pstr + npstr) {
+		*p = (struct pstr_s){.fd = -1, .prev = PSTR_NIL, .next = PSTR_NIL};
+		if (UNLIKELY((p->p = malloc(z + 1U)) == NULL)) {
+			return PSTR_NIL;
+		}
+		memcpy(p->p, s, z);
+		p->p[p->pz = z] = '\0';
+	}
+	phtb[k] = ++npstr;
+	/* announce the new file */
+	printf("%s%04zu\t%.*s\n", prfx, npstr - 1U, (int)z, s);
+	return npstr - 1U;
+}
+
+static void
+pstr_stmt(size_t i, const char *sub, size_t sz,
+	  const char *pre, size_t pz, const char *obj, size_t oz)
+{
+	struct pstr_s *p = pstr + i;
+
+	if (p->dix < pdix) {
+		/* catch up on directives */
+		pstr_add(i, pdir + p->dix, pdix - p->dix);
+		p->dix = pdix;
+	}
+	pstr_add(i, sub, sz);
+	if (pz) {
+		pstr_add(i, " ", 1U);
+		pstr_add(i, pre, pz);
+		pstr_add(i, " ", 1U);
+		pstr_add(i, obj, oz);
+	}
+	pstr_add(i, " .\n", 3U);
+	return;
+}
+
+static void
+free_pred(void)
+{
+	for (size_t i = 0U; i < npstr; i++) {
+		if (pstr[i].fd >= 0) {
+			close(pstr[i].fd);
+		}
+		free(pstr[i].buf);
+		free(pstr[i].p);
+	}
+	free(pstr);
+	free(phtb);
+	free(pdir);
+	return;
+}
+
+static void
+wr_pred(const char *s, size_t z)
+{
+/* split statement S into one statement per predicate
+ * and hand them to the predicate's stream */
+#define fini_pred()	wr_pred(NULL, 0U)
+	if (UNLIKELY(z == 0U)) {
+		/* flush everything, streams stay alive across files */
+		for (size_t i = 0U; i < npstr; i++) {
+			pstr_flush(i);
+		}
+		return;
+	}
+
+	if (*s == '@') {
+		/* directives go to all streams, lazily */
+		if (UNLIKELY(pdix + z + 1U > pdsz)) {
+			const size_t nuz = next_2pow(pdix + z + 1U);
+			char *nud = realloc(pdir, nuz);
+
+			if (UNLIKELY(nud == NULL)) {
+				return;
+			}
+			pdir = nud;
+			pdsz = nuz;
+		}
+		memcpy(pdir + pdix, s, z);
+		pdix += z;
+		pdir[pdix++] = '\n';
+		return;
+	}
+
+	/* S ends in a dot */
+	with (const char *const ep = s + z - 1U,
+	      *sb = s, *se = term_end(s, ep), *pp = term_skip(se, ep)) {
+		size_t i;
+
+		while (pp < ep) {
+			const char *pe = term_end(pp, ep);
+			const char *ob = term_skip(pe, ep);
+			const char *oe = ob;
+			const char *np;
+
+			if (UNLIKELY(pe <= pp)) {
+				/* we're lost */
+				break;
+			}
+			/* find the end of the object list */
+			for (np = ob; np < ep;) {
+				const char *x = term_end(np, ep);
+
+				if (UNLIKELY(x <= np)) {
+					break;
+				}
+				oe = x;
+				np = term_skip(x, ep);
+				if (np >= ep || *np != ',') {
+					break;
+				}
+				np = term_skip(np + 1U, ep);
+			}
+			if ((i = pstr_get(pp, pe - pp)) != PSTR_NIL) {
+				pstr_stmt(i, sb, se - sb, pp, pe - pp, ob, oe - ob);
+			}
+			/* advance to the next predicate */
+			for (; np < ep && (*np == ';' || *np == ',');
+			     np = term_skip(np + 1U, ep));
+			if (np <= pp) {
+				break;
+			}
+			pp = np;
+		}
+		if (pp == term_skip(se, ep) && pp >= ep) {
+			/* no predicates at all, use the empty stream */
+			if ((i = pstr_get("", 0U)) != PSTR_NIL) {
+				pstr_stmt(i, sb, ep - sb, NULL, 0U, NULL, 0U);
+			}
+		}
+	}
+	return;
+}
+
+static void
+wr_stmt(const char *s, size_t z)
+{
+	static char _buf[4096U];
+	static char *buf = _buf;
+	static size_t bsz = sizeof(_buf);
+	static size_t bix = 0U;
+	static char _dir[4096U];
+	static char *dir = _dir;
+	static size_t dsz = sizeof(_dir);
+	static size_t dix = 0U;
+	static size_t istmt;
+	static bool opnp;
+	/* input offset past the last statement in the chunk */
+	static size_t coff;
+	/* subject of the statement that filled the chunk */
+	static char subj[256U];
+	static size_t subz;
+
+#define fini_stmt()	wr_stmt(NULL, 0U)
+#define rot_stmt()	wr_stmt(NULL, 1U)
+#define cut_stmt()	wr_stmt(NULL, 2U)
+	if (byp) {
+		wr_pred(s, z);
+		return;
+	} else if (UNLIKELY(s == NULL && z)) {
+		/* rotation instruction, close chunk if it's got statements,
+		 * or, for cut instructions, if it's full */
+		if (opnp && istmt && !strm && (z == 1U || istmt >= nstmt)) {
+			goto rot;
+		}
+		return;
+	} else if (UNLIKELY(z == 0U)) {
+		/* flushing instruction */
+		if (LIKELY(opnp)) {
+			wr_chnk(buf, bix);
+			if (ckfn != NULL) {
+				ckpt_cls(cfi, coff, dir, dix);
+			}
+			cls_chnk();
+			opnp = false;
+			ncls++;
+		}
+
+		if (buf != _buf) {
+			munmap(buf, bsz);
+			buf = _buf;
+			bsz = sizeof(_buf);
+		}
+		bix = 0U;
+		istmt = 0U;
+		cbeg = 0U;
+
+		if (dir != _dir) {
+			munmap(dir, dsz);
+			dir = _dir;
+			dsz = sizeof(_dir);
+		}
+		dix = 0U;
+		subz = 0U;
+		return;
+	} else if (UNLIKELY(strm > STRM_BEG)) {
+		/* more of an oversized statement, the chunk's open already */
+		goto more;
+	} else if (UNLIKELY(istmt >= nstmt) && *s != '@' && !holdp) {
+		/* in the slack, cut unless the subject is still the same */
+		if (!subz || z <= subz || memcmp(s, subj, subz) ||
+		    (unsigned char)s[subz] > ' ') {
+			rot_stmt();
+		}
+	}
+
+	/* prep next output file, there will definitely be content,
+	 * directives alone won't do though */
+	if (UNLIKELY(!opnp) && (*s != '@' || strm)) {
+		if (UNLIKELY(opn_chnk(cstmt++) < 0)) {
+			return;
+		}
+		opnp = true;
+	}
+
+	if (*s == '@' && !strm) {
+		/* cache directives */
+		/* firstly check whether to resize our directives buffer */
+		if (UNLIKELY(dix + z + 1U/*\n*/ > dsz)) {
+			/* resize */
+			RESZ(dir, dsz, next_2pow(dix + z + 1U))
+			else {
+				return;
+			}
+		}
+		/* just append him */
+		memcpy(dir + dix, s, z);
+		dix += z;
+		dir[dix++] = '\n';
+	}
+
+more:
+	if (UNLIKELY(bix + z + 2U/*\n*/ > bsz)) {
+		/* time to flush */
+		if (LIKELY(opnp)) {
+			wr_chnk(buf, bix);
+			/* reset index pointer */
+			bix = 0U;
+		}
+
+		if (UNLIKELY(bix + z + 2U/*\n*/ > bsz)) {
+			/* resize :O */
+			RESZ(buf, bsz, next_2pow(bix + z + 2U))
+			else {
+				return;
+			}
+		}
+	}
+
+	/* directives won't qualify as statements */
+	if (UNLIKELY(strm > STRM_BEG)) {
+		;
+	} else if (*s != '@' || strm) {
+		buf[bix++] = '\n';
+		if (!istmt++) {
+			/* start the clock for followers */
+			cbeg = now_ms();
+		}
+	}
+	/* copy beef */
+	memcpy(buf + bix, s, z);
+	bix += z;
+	if (UNLIKELY(strm) && strm < STRM_END) {
+		/* statement isn't over yet */
+		return;
+	}
+	/* append newline */
+	buf[bix++] = '\n';
+	coff = soff;
+
+	if (UNLIKELY(istmt == nstmt && slack) && *s != '@' && !strm) {
+		/* remember the subject, a prefix compare is all we need */
+		for (subz = 0U; subz < z && subz < sizeof(subj) &&
+			     (unsigned char)s[subz] > ' '; subz++);
+		if (subz >= sizeof(subj) || *s == '[' || *s == '(') {
+			/* no runs for anonymous or overlong subjects */
+			subz = 0U;
+		}
+		memcpy(subj, s, subz);
+	}
+	if (istmt >= nstmt + slack && !holdp) {
+	rot:
+		/* flush */
+		wr_chnk(buf, bix);
+		if (ckfn != NULL) {
+			ckpt_cls(cfi, coff, dir, dix);
+		}
+		cls_chnk();
+		opnp = false;
+
+		/* reset counter */
+		istmt = 0U;
+		cbeg = 0U;
+		subz = 0U;
+		ncls++;
+
+		/* prep buffer for next run */
+		if (UNLIKELY(dix > bsz)) {
+			RESZ(buf, bsz, next_2pow(dix))
+			else {
+				bix = 0U;
+				return;
+			}
+		}
+		memcpy(buf, dir, bix = dix);
+	}
+	return;
+}
+
+
+/* blank node closures
+ * Statements sharing a labelled blank node are held back in a window
+ * of BNCW statements and united, each connected group is then written
+ * to the same chunk.  Statements that turn up after their group went
+ * into an already closed chunk end up in the spill file. */
+#define BLBL_LIVE	((size_t)-1)
+#define BLBL_SPILL	((size_t)-2)
+#define BSTM_NIL	((size_t)-1)
+
+struct bstm_s {
+	char *s;
+	size_t z;
+	/* union-find parent as sequence number, roots are the oldest */
+	size_t up;
+	/* next member of the group, BSTM_NIL ends the list,
+	 * and, for roots, the last member */
+	size_t nxt;
+	size_t tl;
+	/* root only: group must go to the current chunk, or spill */
+	bool pinp;
+	bool spillp;
+};
+
+struct blbl_s {
+	char *l;
+	size_t lz;
+	/* latest statement in window carrying the label */
+	size_t seq;
+	/* chunk number the group went to, or BLBL_LIVE, or BLBL_SPILL */
+	size_t chnk;
+};
+
+/* the window, a ring of BNCW statements, sequence numbers [blo, bhi) */
+static struct bstm_s *bwin;
+static size_t blo, bhi;
+/* label table, with hash table of label indices + 1 */
+static struct blbl_s *blbl;
+static size_t nblbl;
+static size_t zblbl;
+static size_t *bhtb;
+static size_t zbhtb;
+/* directives of the current file for the spill file */
+static char *bdir;
+static size_t bdix;
+static size_t bdsz;
+/* spill file and its buffer, number of spill files, statements spilt */
+static int bspfd = -1;
+static obuf_t bspob;
+static size_t nbspf;
+static size_t nbspill;
+/* scratch space for the members of the group being emitted,
+ * groups never outgrow the window */
+static size_t *bgrp;
+/* streamed statements that couldn't join their groups */
+static size_t nbstrm;
+
+static const char*
+bnc_lbl(const char *b, const char *s, const char *e, size_t *z)
+{
+/* find next blank node label in [S, E) of the statement starting at B */
+	for (const char *p = s; p < e;) {
+		switch (*p) {
+		case '<':
+			for (p++; p < e && *p != '>'; p++);
+			p++;
+			continue;
+		case '"':
+		case '\'':
+			p = term_end(p, e);
+			continue;
+		case '#':
+			for (; p < e && *p != '\n'; p++);
+			continue;
+		case '_':
+			if (p + 1U < e && p[1U] == ':' &&
+			    (p == b || p[-1] <= ' ' ||
+			     p[-1] == '(' || p[-1] == '[' ||
+			     p[-1] == ',' || p[-1] == ';')) {
+				const char *q = term_end(p, e);
+
+				*z = q - p;
+				return p;
+			}
+			p++;
+			continue;
+		default:
+			p++;
+			continue;
+		}
+	}
+	return NULL;
+}
+
+static size_t
+bnc_find(size_t n)
+{
+	/* path halving */
+	for (struct bstm_s *x; (x = bwin + n % bncw)->up != n;) {
+		x->up = bwin[x->up % bncw].up;
+		n = x->up;
+	}
+	return n;
+}
+
+static size_t
+bnc_get(const char *l, size_t lz)
+{
+	const uint64_t h = hash_str(l, lz);
+	size_t k;
+
+	if (UNLIKELY(2U * nblbl >= zbhtb)) {
+		/* rehash */
+		const size_t nuz = zbhtb ? zbhtb << 1U : 1024U;
+		size_t *nuh = calloc(nuz, sizeof(*nuh));
+
+		if (UNLIKELY(nuh == NULL)) {
+			return BLBL_LIVE;
+		}
+		for (size_t j = 0U; j < nblbl; j++) {
+			const uint64_t hj = hash_str(blbl[j].l, blbl[j].lz);
+
+			for (k = hj & (nuz - 1U); nuh[k]; k = (k + 1U) & (nuz - 1U));
+			nuh[k] = j + 1U;
+		}
+		free(bhtb);
+		bhtb = nuh;
+		zbhtb = nuz;
+	}
+	for (k = h & (zbhtb - 1U); bhtb[k]; k = (k + 1U) & (zbhtb - 1U)) {
+		const struct blbl_s *x = blbl + bhtb[k] - 1U;
+
+		if (x->lz == lz && !memcmp(x->l, l, lz)) {
+			return bhtb[k] - 1U;
+		}
+	}
+	/* new label */
+	if (UNLIKELY(nblbl >= zblbl)) {
+		const size_t nuz = zblbl ? zblbl << 1U : 1024U;
+		struct blbl_s *nub = realloc(blbl, nuz * sizeof(*nub));
+
+		if (UNLIKELY(nub == NULL)) {
+			return BLBL_LIVE;
+		}
+		blbl = nub;
+		zblbl = nuz;
+	}
+	if (UNLIKELY((blbl[nblbl].l = malloc(lz)) == NULL)) {
+		return BLBL_LIVE;
+	}
+	memcpy(blbl[nblbl].l, l, blbl[nblbl].lz = lz);
+	blbl[nblbl].seq = BLBL_LIVE;
+	blbl[nblbl].chnk = BLBL_LIVE;
+	bhtb[k] = nblbl + 1U;
+	return nblbl++;
+}
+
+static void
+bnc_spill(const char *s, size_t z)
+{
+	if (UNLIKELY(bspfd < 0)) {
+		char fn[4096U];
+
+		snprintf(fn, sizeof(fn), "%sspill%04zu", prfx, nbspf++);
+		if (UNLIKELY((bspfd = open(fn, O_WRONLY | O_CREAT | O_TRUNC,
+					   0666)) < 0)) {
+			error("Error: cannot open spill file `%s'", fn);
+			return;
+		} else if (UNLIKELY((bspob = make_obuf(bspfd, 0U, 0U)) == NULL)) {
+			error("Error: cannot set up buffer for `%s'", fn);
+			close(bspfd);
+			bspfd = -1;
+			return;
+		}
+		errno = 0, error("\
+Warning: blank node groups outgrew the window, spilling to `%s'", fn);
+		obuf_write(bspob, bdir, bdix);
+	}
+	obuf_writev(bspob, (struct iovec[]){{(char*)deconst(s), z}, {"\n", 1U}}, 2);
+	nbspill++;
+	return;
+}
+
+static int
+bnc_cmp(const void *a, const void *b)
+{
+	const size_t x = *(const size_t*)a;
+	const size_t y = *(const size_t*)b;
+
+	return (x > y) - (x < y);
+}
+
+static void
+bnc_emit(size_t r)
+{
+/* write out the group rooted at R */
+	const bool spillp = bwin[r % bncw].spillp;
+	size_t ngrp = 0U;
+	size_t lz;
+
+	/* collect the members, lists are concatenated upon union so
+	 * they have to be put back into input order */
+	for (size_t i = r; i != BSTM_NIL; i = bwin[i % bncw].nxt) {
+		bgrp[ngrp++] = i;
+	}
+	qsort(bgrp, ngrp, sizeof(*bgrp), bnc_cmp);
+
+	if (!bwin[r % bncw].pinp && !spillp) {
+		/* new groups may start a new chunk, pinned ones mustn't */
+		cut_stmt();
+	}
+	/* no rotation until the whole group is written */
+	holdp = true;
+	for (size_t k = 0U; k < ngrp; k++) {
+		struct bstm_s *x = bwin + bgrp[k] % bncw;
+
+		if (spillp) {
+			bnc_spill(x->s, x->z);
+		} else {
+			wr_stmt(x->s, x->z);
+		}
+		/* labels are settled now, note the chunk they went to */
+		for (const char *l = x->s, *const e = x->s + x->z;
+		     (l = bnc_lbl(x->s, l, e, &lz)) != NULL; l += lz) {
+			size_t j;
+
+			if ((j = bnc_get(l, lz)) != BLBL_LIVE) {
+				blbl[j].chnk = spillp ? BLBL_SPILL : ncls;
+			}
+		}
+		free(x->s);
+		x->s = NULL;
+	}
+	holdp = false;
+	/* advance the window */
+	for (; blo < bhi && bwin[blo % bncw].s == NULL; blo++);
+	return;
+}
+
+static void
+bnc_flush(void)
+{
+	for (; blo < bhi;) {
+		/* the oldest statement is always its group's root */
+		bnc_emit(blo);
+	}
+	return;
+}
+
+static void
+wr_bnc(const char *s, size_t z)
+{
+	const char *const e = s + z;
+	struct bstm_s *x;
+	size_t n;
+	size_t r;
+	size_t lz;
+	bool pinp = false;
+	bool spillp = false;
+
+	if (UNLIKELY(*s == '@')) {
+		/* groups mustn't see prefixes defined after them */
+		bnc_flush();
+		if (UNLIKELY(bdix + z + 1U > bdsz)) {
+			const size_t nuz = next_2pow(bdix + z + 1U);
+			char *nud = realloc(bdir, nuz);
+
+			if (UNLIKELY(nud == NULL)) {
+				return;
+			}
+			bdir = nud;
+			bdsz = nuz;
+		}
+		memcpy(bdir + bdix, s, z);
+		bdix += z;
+		bdir[bdix++] = '\n';
+		if (bspfd >= 0) {
+			obuf_writev(bspob, (struct iovec[]){
+					{(char*)deconst(s), z}, {"\n", 1U}}, 2);
+		}
+		wr_stmt(s, z);
+		return;
+	} else if (bnc_lbl(s, s, e, &lz) == NULL) {
+		/* no labels, no strings attached */
+		wr_stmt(s, z);
+		return;
+	}
+
+	if (UNLIKELY(bwin == NULL)) {
+		if (UNLIKELY((bwin = calloc(bncw, sizeof(*bwin))) == NULL)) {
+			return;
+		} else if (UNLIKELY((bgrp = calloc(
+					     bncw, sizeof(*bgrp))) == NULL)) {
+			free(bwin);
+			bwin = NULL;
+			return;
+		}
+	}
+	if (bhi - blo >= bncw) {
+		/* window's full, the oldest group has to go */
+		bnc_emit(blo);
+	}
+	n = bhi++;
+	x = bwin + n % bncw;
+	if (UNLIKELY((x->s = malloc(z)) == NULL)) {
+		bhi--;
+		return;
+	}
+	memcpy(x->s, s, x->z = z);
+	x->up = n;
+	x->nxt = BSTM_NIL;
+	x->tl = n;
+	x->pinp = x->spillp = false;
+
+	for (const char *l = s; (l = bnc_lbl(s, l, e, &lz)); l += lz) {
+		size_t j;
+
+		if ((j = bnc_get(l, lz)) == BLBL_LIVE) {
+			;
+		} else if (blbl[j].chnk == BLBL_LIVE) {
+			if (blbl[j].seq != BLBL_LIVE) {
+				/* unite, older root wins */
+				size_t ra = bnc_find(n);
+				size_t rb = bnc_find(blbl[j].seq);
+
+				if (ra > rb) {
+					const size_t t = ra;
+
+					ra = rb;
+					rb = t;
+				}
+				if (ra < rb) {
+					/* RB's group joins RA's */
+					struct bstm_s *a = bwin + ra % bncw;
+					struct bstm_s *b = bwin + rb % bncw;
+
+					b->up = ra;
+					bwin[a->tl % bncw].nxt = rb;
+					a->tl = b->tl;
+					pinp |= b->pinp;
+					spillp |= b->spillp;
+				}
+			}
+			blbl[j].seq = n;
+		} else if (blbl[j].chnk == ncls) {
+			/* group's chunk is still open, join it */
+			pinp = true;
+		} else {
+			spillp = true;
+		}
+	}
+	r = bnc_find(n);
+	bwin[r % bncw].pinp |= pinp;
+	bwin[r % bncw].spillp |= spillp;
+	if (bwin[r % bncw].pinp || bwin[r % bncw].spillp) {
+		bnc_emit(r);
+	}
+	return;
+}
+
+static void
+bnc_strm(const char *s, size_t z)
+{
+/* write a piece of a statement that's streamed through, it can't be
+ * held back, so whatever is goes first and its labels are pinned to
+ * the chunk it's written to, a label straddling two pieces goes
+ * unnoticed though */
+	static bool lostp;
+	size_t lz;
+
+	if (strm == STRM_BEG) {
+		/* held back statements are whole, tell wr_stmt() */
+		strm = STRM_NONE;
+		bnc_flush();
+		strm = STRM_BEG;
+		lostp = false;
+	}
+	wr_stmt(s, z);
+	for (const char *l = s, *const e = s + z;
+	     (l = bnc_lbl(s, l, e, &lz)) != NULL; l += lz) {
+		size_t j;
+
+		if ((j = bnc_get(l, lz)) == BLBL_LIVE) {
+			;
+		} else if (blbl[j].chnk == BLBL_LIVE || blbl[j].chnk == ncls) {
+			blbl[j].chnk = ncls;
+		} else if (!lostp) {
+			/* its group's gone already, count it */
+			lostp = true;
+			nbstrm++;
+		}
+	}
+	return;
+}
+
+static void
+fini_bnc(void)
+{
+/* write out what's held back, labels are scoped by document */
+	bnc_flush();
+	for (size_t j = 0U; j < nblbl; j++) {
+		free(blbl[j].l);
+	}
+	nblbl = 0U;
+	if (bhtb != NULL) {
+		memset(bhtb, 0, zbhtb * sizeof(*bhtb));
+	}
+	bdix = 0U;
+	if (bspfd >= 0) {
+		free_obuf(bspob);
+		bspob = NULL;
+		close(bspfd);
+		bspfd = -1;
+	}
+	return;
+}
+
+static void
+free_bnc(void)
+{
+	free(bgrp);
+	free(bwin);
+	free(blbl);
+	free(bhtb);
+	free(bdir);
+	return;
+}
+
+
+/* indexing */
+static void
+idx_stmt(const char *s, size_t z, size_t off)
+{
+	if (*s == '@') {
+		ttlidx_add_dir(sidx, s, z);
+	} else {
+		ttlidx_add_stmt(sidx, off);
+	}
+	return;
+}
+
+static void
+idx_fini(const char *fn)
+{
+	static const char sfx[] = ".ttlidx";
+	char ifn[4096U];
+	struct stat st;
+
+	if (sidx == NULL) {
+		return;
+	}
+	snprintf(ifn, sizeof(ifn), "%s%s", fn, sfx);
+	if (stat(fn, &st) < 0) {
+		error("Error: cannot stat `%s', index not written", fn);
+	} else if (ttlidx_write(sidx, ifn, &st) < 0) {
+		error("Error: cannot write index `%s'", ifn);
+	}
+	free_ttlidx(sidx);
+	sidx = NULL;
+	return;
+}
+
+
+/* splitting into N parts by seeking */
+#define RESYNC_LOOKAHEAD	(1U << 20U)
+#define RESYNC_NCHK		(4U)
+
+struct part_s {
+	const char *hdr;
+	size_t hz;
+	const char *beg;
+	size_t len;
+	char fn[];
+};
+
+static void
+wr_part(void *clo)
+{
+/* runs on the pool */
+	struct part_s *p = clo;
+	const int fl = O_CREAT | O_TRUNC | O_WRONLY;
+	int fd;
+
+	if (LIKELY((fd = open(p->fn, fl, 0666)) >= 0)) {
+		const bool nlp = p->len && p->beg[p->len - 1U] != '\n';
+
+		wr_iov(fd, (struct iovec[]){
+				{(char*)deconst(p->hdr), p->hz},
+				{(char*)deconst(p->beg), p->len},
+				{"\n", nlp},
+			}, 3);
+		close(fd);
+	} else {
+		error("Error: cannot open `%s'", p->fn);
+	}
+	free(p);
+	return;
+}
+
+static int
+nsplit1(const char *fn, size_t n, pool_t pp)
+{
+	static size_t cno;
+	struct stat st;
+	const char *m;
+	size_t mz;
+	size_t hz;
+	const char *dirs = NULL;
+	ttlidx_t x = NULL;
+	int rc = 0;
+	int fd;
+
+	if (fn == NULL) {
+		errno = 0, error("Error: -n needs a regular file");
+		return -1;
+	} else if ((fd = open(fn, O_RDONLY)) < 0) {
+		error("Error: cannot open file `%s'", fn);
+		return -1;
+	} else if (fstat(fd, &st) < 0 || !S_ISREG(st.st_mode)) {
+		errno = 0, error("Error: -n needs a regular file");
+		close(fd);
+		return -1;
+	} else if (!(mz = st.st_size)) {
+		close(fd);
+		return 0;
+	}
+	m = mmap(NULL, mz, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (UNLIKELY(m == MAP_FAILED)) {
+		error("Error: cannot map file `%s'", fn);
+		return -1;
+	} else if (frame_magicp(m, mz) > 0) {
+		errno = 0, error("Error: -n needs turtle input");
+		munmap(deconst(m), mz);
+		return -1;
+	}
+	(void)madvise(deconst(m), mz, MADV_SEQUENTIAL);
 
-#define fini_stmt()	wr_stmt(NULL, 0U)
-	if (UNLIKELY(z == 0U)) {
-		/* flushing instruction */
-		if (LIKELY(cfd >= 0)) {
-			wr_buf(cfd, buf, bix);
-			close(cfd);
-			cfd = -1;
+	/* if there's an index, use it, otherwise resync heuristically */
+	with (char ifn[4096U]) {
+		snprintf(ifn, sizeof(ifn), "%s.ttlidx", fn);
+		if ((x = ttlidx_open(ifn, &st)) != NULL) {
+			dirs = ttlidx_dirs(x, NULL);
+		} else if (errno == ESTALE || errno == EINVAL) {
+			error("\
+Warning: ignoring index `%s'", ifn);
 		}
+	}
+	/* directives at the beginning of the file */
+	hz = range_head(m, mz);
 
-		if (buf != _buf) {
-			munmap(buf, bsz);
-			buf = _buf;
-			bsz = sizeof(_buf);
-		}
-		bix = 0U;
+	for (size_t k = 0U, beg = 0U; k < n && beg < mz; k++) {
+		size_t end = mz;
+		const char *hdr = NULL;
+		size_t hdrz = 0U;
+		struct part_s *p;
 
-		if (dir != _dir) {
-			munmap(dir, dsz);
-			dir = _dir;
-			dsz = sizeof(_dir);
+		if (k + 1U < n) {
+			const size_t tgt = (k + 1U) * (mz / n);
+			const char *bo;
+
+			if (tgt <= beg) {
+				/* previous boundary overshot us */
+				continue;
+			} else if (x != NULL) {
+				end = ttlidx_find(x, tgt, NULL);
+				end = end < mz ? end : mz;
+			} else if ((bo = term_resync(
+					    m + tgt, m + (mz - tgt < RESYNC_LOOKAHEAD
+							  ? mz : tgt + RESYNC_LOOKAHEAD),
+					    RESYNC_NCHK)) != NULL) {
+				end = bo - m;
+			} else {
+				/* no boundary, fold into next part */
+				continue;
+			}
 		}
-		dix = 0U;
-		return;
+		if (beg > 0U) {
+			/* prepend directives */
+			hdr = m;
+			hdrz = hz;
+			if (x != NULL) {
+				/* the index knows better */
+				ttlidx_find(x, beg, &hdrz);
+				hdr = dirs;
+			}
+		}
+		if (UNLIKELY((p = malloc(sizeof(*p) + 4096U)) == NULL)) {
+			rc = -1;
+			break;
+		}
+		*p = (struct part_s){hdr, hdrz, m + beg, end - beg};
+		snprintf(p->fn, 4096U, "%s%04zu", prfx, cno++);
+		pool_push(pp, wr_part, p);
+		beg = end;
 	}
+	/* parts refer to the map and the index */
+	pool_wait(pp);
+	if (x != NULL) {
+		free_ttlidx(x);
+	}
+	munmap(deconst(m), mz);
+	return rc;
+}
 
-	/* prep next output file, there will definitely be content */
-	if (UNLIKELY(cfd < 0)) {
-		static char tmpfn[4096U];
-		const int fl = O_CREAT | O_TRUNC | O_RDWR;
+
+/* the actual splitting */
+static ssize_t
+proc(const char *buf, size_t bsz, bool lastp)
+{
+	const char *sp = buf;
+	const char *const ep = buf + bsz;
+	const char *bo;
 
-		snprintf(tmpfn, sizeof(tmpfn), "%s%04zu", prfx, cstmt++);
-		if (UNLIKELY((cfd = open(tmpfn, fl, 0666)) < 0)) {
-			return;
+#define fini_proc()	proc(NULL, 0U, false)
+	if (UNLIKELY(buf == NULL)) {
+		/* and finalise */
+		if (UNLIKELY(strm)) {
+			errno = 0, error("\
+Warning: input ends inside the statement at offset %zu", strm_off);
+			strm = STRM_NONE;
 		}
-	}
-
-	if (*s == '@') {
-		/* cache directives */
-		/* firstly check whether to resize our directives buffer */
-		if (UNLIKELY(dix + z + 1U/*\n*/ > dsz)) {
-			/* resize */
-			RESZ(dir, dsz, next_2pow(z + 1U))
-			else {
-				return;
-			}
+		if (bncw) {
+			fini_bnc();
 		}
-		/* just append him */
-		memcpy(dir + dix, s, z);
-		dix += z;
-		dir[dix++] = '\n';
+		fini_stmt();
+		memset(&scn, 0, sizeof(scn));
+		return 0;
 	}
 
-	if (UNLIKELY(bix + z + 2U/*\n*/ > bsz)) {
-		/* time to flush */
-		wr_buf(cfd, buf, bix);
-		/* reset index pointer */
-		bix = 0U;
+	for (const char *eo;
+	     (eo = (lastp ? scan_last : scan_stmt)(&scn, &bo, sp, ep)) != NULL;
+	     sp = eo) {
+		char dir[4096U];
+		const char *s = bo;
+		size_t z = eo - bo;
 
-		if (UNLIKELY(z + 2U/*\n*/ > bsz)) {
-			/* resize :O */
-			RESZ(buf, bsz, next_2pow(z + 2U))
-			else {
-				return;
+		soff = ioff + (eo - buf);
+		if (UNLIKELY(strm == STRM_MORE)) {
+			/* last bit of an oversized statement */
+			if (UNLIKELY(sidx != NULL)) {
+				ttlidx_add_stmt(sidx, strm_off);
 			}
+			strm = STRM_END;
+			if (bncw) {
+				bnc_strm(s, z);
+			} else {
+				wr_stmt(s, z);
+			}
+			strm = STRM_NONE;
+			continue;
+		} else if (UNLIKELY(scn.dirp && *s != '@')) {
+			/* turn sparql style directives into turtle ones */
+			if (!(z = scan_dir(dir, sizeof(dir), s, z))) {
+				continue;
+			}
+			s = dir;
+		}
+		if (UNLIKELY(sidx != NULL)) {
+			idx_stmt(s, z, ioff + (sp - buf));
+		}
+		if (bncw) {
+			wr_bnc(s, z);
+		} else {
+			wr_stmt(s, z);
 		}
 	}
-
-	/* directives won't qualify as statements */
-	if (*s != '@') {
-		buf[bix++] = '\n';
-		istmt++;
+	if (UNLIKELY(strm) && ep - bo > 1) {
+		/* pass on what we've got but the last byte, the scanner
+		 * needs it to tell where the statement ends */
+		if (strm == STRM_BEG) {
+			strm_off = ioff + (sp - buf);
+		}
+		if (bncw) {
+			bnc_strm(bo, ep - 1 - bo);
+		} else {
+			wr_stmt(bo, ep - 1 - bo);
+		}
+		strm = STRM_MORE;
+		scn.pos = 1U;
+		bo = ep - 1;
 	}
-	/* copy beef */
-	memcpy(buf + bix, s, z);
-	bix += z;
-	/* append newline */
-	buf[bix++] = '\n';
-
-	if (istmt >= nstmt) {
-		/* flush */
-		wr_buf(cfd, buf, bix);
-		close(cfd);
-		cfd = -1;
+	return bo - buf;
+}
 
-		/* reset counter */
-		istmt = 0U;
+static ssize_t
+proc_frm(const char *buf, size_t bsz, bool lastp)
+{
+/* like proc() but for framed input, frames are statements already */
+	const char *sp = buf;
+	const char *const ep = buf + bsz;
+	struct frame_s f;
 
-		/* prep buffer for next run */
-		memcpy(buf, dir, bix = dix);
+	if (UNLIKELY(frmi == 1)) {
+		sp += FRAME_MAGIC_LEN;
+		frmi = 2;
+	}
+	for (const char *eo; (eo = frame_get(&f, sp, ep)) != NULL; sp = eo) {
+		soff = ioff + (eo - buf);
+		if (bncw) {
+			wr_bnc(f.s, f.z);
+		} else {
+			wr_stmt(f.s, f.z);
+		}
 	}
+	if (UNLIKELY(lastp && sp < ep)) {
+		errno = 0, error("Warning: input ends inside a frame");
+	}
+	return sp - buf;
+}
+
+static void
+quit(int UNUSED(sig))
+{
+	quitp = 1;
 	return;
 }
 
-
-/* the actual splitting */
 static ssize_t
-proc(const char *buf, size_t bsz)
+rd_follow(int fd, char *buf, size_t bsz)
 {
-	const char *sp = buf;
-	const char *const UNUSED(ep) = buf + bsz;
-	enum {
-		FREE,
-		IN_ANGLES,
-		IN_QUOTES,
-		IN_LONG_QUOTES,
-		IN_COMMENT,
-	} st = FREE;
-
-#define fini_proc()	proc(NULL, 0U)
-	if (UNLIKELY(bsz == 0U)) {
-		/* and finalise */
-		fini_stmt();
-		st = FREE;
-		return 0;
-	}
+/* like read(2) but keep waiting at the end of regular files and
+ * publish the current chunk when it's been open for too long,
+ * pipes and sockets still signal the end when the writer is gone */
+	struct stat st;
+	const bool regp = !fstat(fd, &st) && S_ISREG(st.st_mode);
 
-next:
-	/* overread whitespace */
-	for (; *sp > '\0' && *sp <= ' '; sp++);
-
-	/* statements are always concluded by . so look for that guy */
-	for (const char *eo, *tp = sp;
-	     ({
-		     switch (st) {
-		     case FREE:
-			     eo = strpbrk(tp, ".<\"#");
-			     break;
-		     case IN_ANGLES:
-			     eo = strchr(tp, '>');
-			     break;
-		     case IN_QUOTES:
-			     eo = strchr(tp, '"');
-			     break;
-		     case IN_LONG_QUOTES:
-			     eo = strstr(tp, "\"\"\"");
-			     break;
-		     case IN_COMMENT:
-			     eo = strchr(tp, '\n');
-			     break;
-		     default:
-			     /* fuck */
-			     eo = NULL;
-			     break;
-		     }
-		     eo;
-	     }) != NULL; tp = eo) {
-		/* check character at point */
-		switch (*eo++) {
-		case '.':
-			wr_stmt(sp, eo - sp);
-			sp = eo;
-			goto next;
-		case '<':
-			/* find matching > */
-			st = IN_ANGLES;
-			break;
-		case '>':
-			/* yay, go back to free scan */
-			st = FREE;
-			break;
-		case '"':
-			/* skip this occurrence if it's an escaped " */
-			if (LIKELY(!escapedp(eo - 1, tp))) {
-				switch (st) {
-				case FREE:
-					/* check if it's a long quote (""") */
-					if (!eo[0U]) {
-						goto out;
-					} else if (eo[0U] != '"') {
-						st = IN_QUOTES;
-					} else if (!eo[1U]) {
-						goto out;
-					} else if (eo[1U] != '"') {
-						/* oh brill, we're through
-						 * already ... don't change
-						 * the state */
-						eo++;
-					} else {
-						st = IN_LONG_QUOTES;
-						eo += 2U;
-					}
-					break;
-				case IN_QUOTES:
-					st = FREE;
-					break;
-				case IN_LONG_QUOTES:
-					eo += 2U;
-					st = FREE;
-					break;
-				default:
-					/* huh? */
-					break;
-				}
+	while (!quitp) {
+		int tmo = -1;
+
+		if (cbeg && !strm) {
+			/* an oversized statement has to be read in full
+			 * before its chunk can go, no clock for it */
+			const uint64_t age = now_ms() - cbeg;
+
+			if (age < maxlat) {
+				tmo = (int)(maxlat - age);
+			} else {
+				/* if the rotation is deferred nothing but
+				 * more input can change that, so read on */
+				rot_stmt();
 			}
-			break;
-		case '#':
-			assert(st == FREE);
-			st = IN_COMMENT;
-			break;
-		case '\n':
-			assert(st == IN_COMMENT);
-			st = FREE;
-			break;
+		}
+		if (regp) {
+			/* regular files never block, nap if there's nothing */
+			struct timespec nap = {0, 100000000L};
+			ssize_t nrd;
+
+			if ((nrd = read(fd, buf, bsz)) != 0) {
+				return nrd;
+			} else if (tmo >= 0 && tmo < 100) {
+				nap.tv_nsec = tmo * 1000000L;
+			}
+			nanosleep(&nap, NULL);
+			continue;
+		}
+		switch (poll(&(struct pollfd){fd, POLLIN, 0}, 1U, tmo)) {
+		case 0:
+			/* timed out, rotate */
+			continue;
+		case -1:
+			if (errno == EINTR) {
+				continue;
+			}
+			return -1;
 		default:
-			break;
+			return read(fd, buf, bsz);
 		}
 	}
-out:
-	return sp - buf;
+	return 0;
 }
 
 static int
@@ -358,37 +2263,98 @@ split1(const char *fn)
 	} else if ((fd = open(fn, O_RDONLY)) < 0) {
 		return -1;
 	}
+	if (istrd && fn != NULL) {
+		sidx = make_ttlidx(istrd);
+	}
 	/* read into buf */
 	bix = 0U;
+	ioff = 0U;
+	frmi = -1;
+	if (UNLIKELY(rsmp)) {
+		/* pick up where the manifest left off, but find out
+		 * whether the input is framed first */
+		rsmp = false;
+		if (rsm_off >= FRAME_MAGIC_LEN) {
+			for (ssize_t nrd; bix < FRAME_MAGIC_LEN &&
+				     (nrd = read(fd, buf + bix,
+						 FRAME_MAGIC_LEN - bix)) > 0;
+			     bix += nrd);
+			frmi = frame_magicp(buf, bix) > 0 ? 2 : 0;
+		}
+		if (UNLIKELY(ckpt_skip(fd, rsm_off - bix) < 0)) {
+			error("Error: cannot resume `%s' at %zu",
+			      fn ?: "-", rsm_off);
+			close(fd);
+			return -1;
+		}
+		bix = 0U;
+		ioff = rsm_off;
+		for (const char *dp = rsm_dir, *const ep = rsm_dir + rsm_dz,
+			     *eol; dp < ep; dp = eol + 1U) {
+			if ((eol = memchr(dp, '\n', ep - dp)) == NULL) {
+				eol = ep;
+			}
+			if (eol > dp) {
+				wr_stmt(dp, eol - dp);
+			}
+		}
+	}
 	for (ssize_t nrd, npr;
-	     (nrd = read(fd, buf + bix, bsz - bix - 1U/*\nul*/)) > 0;) {
+	     (nrd = !follow
+	      ? read(fd, buf + bix, bsz - bix - 1U/*\nul*/)
+	      : rd_follow(fd, buf + bix, bsz - bix - 1U/*\nul*/)) > 0;) {
 		/* mark the end of the buffer */
 		buf[bix += nrd] = '\0';
-		if ((npr = proc(buf, bix)) < 0) {
+		if (UNLIKELY(frmi < 0) && (frmi = frame_magicp(buf, bix)) < 0) {
+			/* can't tell yet whether it's framed */
+			continue;
+		} else if (UNLIKELY(frmi == 1 && sidx != NULL)) {
+			errno = 0, error("\
+Warning: no index for framed input");
+			free_ttlidx(sidx);
+			sidx = NULL;
+		}
+		if ((npr = (frmi ? proc_frm : proc)(buf, bix, false)) < 0) {
 			goto fuck;
-		} else if (npr == 0 && bix + 1 >= bsz) {
+		} else if (npr == 0 && bix + 1 >= bsz && bsz >= bcap &&
+			   !strm && !byp && !frmi) {
+			/* statement won't fit, stream it */
+			strm = STRM_BEG;
+			npr = proc(buf, bix, false);
+		}
+		if (npr == 0 && bix + 1 >= bsz) {
 			/* need a bigger buffer */
 			RESZ(buf, bsz, bsz << 1U)
 			else {
+				error("\
+Error: cannot grow buffer beyond %zu bytes", bsz);
 				goto fuck;
 			}
 		} else if (npr == 0) {
 			/* just read some more */
 			;
-		} else if ((bix -= npr) > 0) {
-			/* memmove to the front */
-			memmove(buf, buf + npr, bix);
+		} else {
+			ioff += npr;
+			if ((bix -= npr) > 0) {
+				/* memmove to the front */
+				memmove(buf, buf + npr, bix);
+			}
 		}
 	}
 	/* finalise buffer again, just in case */
 	buf[bix] = '\0';
 	/* last try, we don't care how much gets processed */
-	(void)proc(buf, bix);
+	(void)(frmi > 0 ? proc_frm : proc)(buf, bix, true);
 	/* finalise processing */
 	fini_proc();
+	idx_fini(fn);
 
 fuck:
 	/* resource freeing */
+	if (sidx != NULL) {
+		free_ttlidx(sidx);
+		sidx = NULL;
+	}
 	close(fd);
 	if (buf != _buf) {
 		munmap(buf, bsz);
@@ -396,11 +2362,267 @@ fuck:
 	return 0;
 }
 
+static int
+range1(const char *fn)
+{
+	struct rmap_s r;
+
+	if (range_map(&r, fn, rng, false) < 0) {
+		if (errno == ESPIPE) {
+			errno = 0, error("Error: --range needs a regular file");
+		} else {
+			error("Error: cannot open file `%s'", fn);
+		}
+		return -1;
+	} else if (frame_magicp(r.m, r.mz) > 0) {
+		errno = 0, error("Error: --range needs turtle input");
+		range_unmap(&r);
+		return -1;
+	}
+	if (r.hdrz) {
+		/* directives from the top of the file */
+		(void)proc(r.hdr, r.hdrz, true);
+	}
+	ioff = r.beg;
+	if (r.end > r.beg) {
+		(void)proc(r.m + r.beg, r.end - r.beg, true);
+	}
+	fini_proc();
+	range_unmap(&r);
+	return 0;
+}
+
 
 #include "ttl-split.yucc"
 
+static int
+setup(const yuck_t argi[static 1U])
+{
+/* turn options into settings, return -1 if they don't make sense */
+	if (argi->statements_arg) {
+		nstmt = strtoul(argi->statements_arg, NULL, 0);
+	}
+	if (argi->prefix_arg) {
+		prfx = argi->prefix_arg;
+	}
+	if (argi->max_buffer_arg) {
+		char *on;
+
+		bcap = strtoul(argi->max_buffer_arg, &on, 0);
+		switch (*on) {
+		case 'G':
+		case 'g':
+			bcap <<= 10U;
+			/* fallthrough */
+		case 'M':
+		case 'm':
+			bcap <<= 10U;
+			/* fallthrough */
+		case 'k':
+		case 'K':
+			bcap <<= 10U;
+		default:
+			break;
+		}
+		if (bcap < 4096U) {
+			bcap = 4096U;
+		}
+	}
+	if (argi->slack_arg) {
+		slack = strtoul(argi->slack_arg, NULL, 0);
+	}
+	if (argi->compress_arg) {
+		static const char *const meths[] = {
+			[COMP_GZIP] = "gzip",
+			[COMP_ZSTD] = "zstd",
+		};
+
+		for (size_t j = COMP_GZIP; j < countof(meths); j++) {
+			if (!strcmp(argi->compress_arg, meths[j])) {
+				comp = j;
+				break;
+			}
+		}
+		switch (comp) {
+#if defined HAVE_ZLIB
+		case COMP_GZIP:
+#endif	/* HAVE_ZLIB */
+#if defined HAVE_ZSTD
+		case COMP_ZSTD:
+#endif	/* HAVE_ZSTD */
+			break;
+		default:
+			errno = 0, error("\
+Error: compression method `%s' not supported", argi->compress_arg);
+			return -1;
+		}
+	}
+	if (argi->index_arg == YUCK_OPTARG_NONE) {
+		istrd = 1000U;
+	} else if (argi->index_arg) {
+		istrd = strtoul(argi->index_arg, NULL, 0);
+	}
+	if (argi->level_arg) {
+		clvl = strtol(argi->level_arg, NULL, 0);
+	}
+	if (argi->follow_flag) {
+		struct sigaction sa = {.sa_handler = quit};
+
+		if (argi->by_arg || argi->number_arg ||
+		    argi->bnode_closure_arg) {
+			errno = 0, error("\
+Error: --follow cannot be used with --by, -n or --bnode-closure");
+			return -1;
+		}
+		follow = true;
+		if (argi->max_latency_arg) {
+			maxlat = strtoul(argi->max_latency_arg, NULL, 0);
+		}
+		/* no SA_RESTART, we want to get out of blocking reads */
+		sigaction(SIGINT, &sa, NULL);
+		sigaction(SIGTERM, &sa, NULL);
+	}
+	if (argi->filter_arg) {
+		if (comp) {
+			errno = 0, error("\
+Error: --filter and --compress are mutually exclusive");
+			return -1;
+		}
+		filt = argi->filter_arg;
+		if (argi->max_procs_arg &&
+		    !(maxfilt = strtoul(argi->max_procs_arg, NULL, 0))) {
+			maxfilt = 1U;
+		}
+		/* filters hanging up early shouldn't kill us */
+		signal(SIGPIPE, SIG_IGN);
+	}
+	if (argi->by_arg) {
+		struct rlimit rl;
+
+		if (strcmp(argi->by_arg, "predicate")) {
+			errno = 0, error("\
+Error: cannot split by `%s'", argi->by_arg);
+			return -1;
+		} else if (comp || filt) {
+			errno = 0, error("\
+Error: --by cannot be used with --compress or --filter");
+			return -1;
+		}
+		byp = true;
+		/* leave some descriptors for the rest of us */
+		maxopen = 512U;
+		if (!getrlimit(RLIMIT_NOFILE, &rl) &&
+		    rl.rlim_cur != RLIM_INFINITY && rl.rlim_cur > 32U) {
+			maxopen = rl.rlim_cur - 16U;
+		}
+	}
+	if (argi->bnode_closure_arg == YUCK_OPTARG_NONE) {
+		bncw = 65536U;
+	} else if (argi->bnode_closure_arg &&
+		   !(bncw = strtoul(argi->bnode_closure_arg, NULL, 0))) {
+		bncw = 65536U;
+	}
+	if (bncw && (byp || argi->number_arg)) {
+		errno = 0, error("\
+Error: --bnode-closure cannot be used with --by or -n");
+		return -1;
+	}
+	if (argi->checkpoint_flag || argi->resume_flag) {
+		static char mfn[4096U];
+
+		if (byp || bncw || argi->number_arg) {
+			errno = 0, error("\
+Error: --checkpoint and --resume cannot be used with --by, -n\n\
+or --bnode-closure");
+			return -1;
+		} else if (argi->resume_flag && istrd) {
+			errno = 0, error("\
+Error: --index cannot be used with --resume");
+			return -1;
+		}
+		snprintf(mfn, sizeof(mfn), "%smanifest", prfx);
+		ckfn = mfn;
+		ckin = argi->args;
+		nckin = argi->nargs;
+	}
+	if (argi->range_arg) {
+		if (range_parse(&rng, argi->range_arg) < 0) {
+			errno = 0, error("\
+Error: cannot parse range `%s', must be START:END", argi->range_arg);
+			return -1;
+		} else if (follow || istrd || ckfn != NULL || argi->number_arg) {
+			errno = 0, error("\
+Error: --range cannot be used with -n, --follow, --index\n\
+or --checkpoint and --resume");
+			return -1;
+		}
+		rngp = true;
+	}
+	if (comp) {
+		unsigned int nj = argi->jobs_arg
+			? strtoul(argi->jobs_arg, NULL, 0) : 0U;
+
+		if (UNLIKELY((cpool = make_pool(nj, 0U)) == NULL)) {
+			error("Error: cannot start compressor threads");
+			return -1;
+		}
+	}
+	return 0;
+}
+
+static int
+teardown(void)
+{
+/* wait for everything we've set in motion */
+	int rc = 0;
+
+	if (cpool != NULL) {
+		/* wait for the compressors to finish */
+		free_pool(cpool);
+	}
+	if (nchnk_fail) {
+		errno = 0, error("\
+Error: %zu chunks could not be written", nchnk_fail);
+		rc = 1;
+	}
+	if (byp) {
+		free_pred();
+	}
+	if (bncw) {
+		free_bnc();
+		if (nbspill) {
+			errno = 0, error("\
+Warning: %zu statements spilt to %zu spill files", nbspill, nbspf);
+		}
+		if (nbstrm) {
+			errno = 0, error("\
+Warning: %zu statements were too large to join their blank node group", nbstrm);
+		}
+	}
+	if (filt != NULL) {
+		/* wait for stragglers */
+		while (nfilt > 0U) {
+			reap_filt(true);
+		}
+		if (nfilt_fail) {
+			errno = 0, error("\
+Error: %zu filter invocations failed", nfilt_fail);
+			rc = 1;
+		}
+	}
+	if (ckfn != NULL) {
+		free_ckpt();
+	}
+	return rc;
+}
+
+#if !defined RDFSNIPS
 int
 main(int argc, char *argv[])
+#else  /* RDFSNIPS */
+static int
+ttl_split_main(int argc, char *argv[])
+#endif	/* !RDFSNIPS */
 {
 	yuck_t argi[1U];
 	size_t i = 0U;
@@ -409,13 +2631,48 @@ main(int argc, char *argv[])
 	if (yuck_parse(argi, argc, argv) < 0) {
 		rc = 1;
 		goto out;
+	} else if (setup(argi) < 0) {
+		rc = 1;
+		goto out;
 	}
 
-	if (argi->statements_arg) {
-		nstmt = strtoul(argi->statements_arg, NULL, 0);
+	if (argi->resume_flag) {
+		if ((rsm_dir = ckpt_rd(&i, &rsm_off, &cstmt, &rsm_dz)) == NULL) {
+			rc = 1;
+			goto out;
+		}
+		rsmp = true;
 	}
-	if (argi->prefix_arg) {
-		prfx = argi->prefix_arg;
+
+	if (argi->number_arg) {
+		/* split by seeking */
+		const size_t n = strtoul(argi->number_arg, NULL, 0);
+		unsigned int nj = argi->jobs_arg
+			? strtoul(argi->jobs_arg, NULL, 0) : 0U;
+		pool_t pp;
+
+		if (comp || filt || byp) {
+			errno = 0, error("\
+Error: -n cannot be used with --compress, --filter or --by");
+			rc = 1;
+			goto out;
+		} else if (UNLIKELY(!n)) {
+			errno = 0, error("Error: -n needs a positive number");
+			rc = 1;
+			goto out;
+		} else if (UNLIKELY((pp = make_pool(nj, 0U)) == NULL)) {
+			error("Error: cannot start writer threads");
+			rc = 1;
+			goto out;
+		}
+		if (argi->nargs == 0U) {
+			rc -= nsplit1(NULL, n, pp);
+		}
+		for (; i < argi->nargs; i++) {
+			rc -= nsplit1(argi->args[i], n, pp);
+		}
+		free_pool(pp);
+		goto out;
 	}
 
 	if (argi->nargs == 0U) {
@@ -423,12 +2680,73 @@ main(int argc, char *argv[])
 	}
 	for (; i < argi->nargs; i++) {
 	one:
-		rc -= split1(argi->args[i]);
+		cfi = i;
+		rc -= !rngp ? split1(argi->args[i]) : range1(argi->args[i]);
 	}
+	rc = teardown() ?: rc;
 
 out:
 	yuck_free(argi);
 	return rc;
 }
 
+#if defined RDFSNIPS
+/* as a stage of a fused pipeline */
+static yuck_t stg_argi[1U];
+static stage_stmt_f stg_nxt;
+
+static int
+stg_init(int argc, char *argv[], stage_stmt_f nxt, char ***args)
+{
+	int n;
+
+	if (yuck_parse(stg_argi, argc, argv) < 0) {
+		return -1;
+	} else if (stg_argi->number_arg || stg_argi->follow_flag ||
+		   stg_argi->index_arg || stg_argi->range_arg ||
+		   stg_argi->checkpoint_flag || stg_argi->resume_flag) {
+		errno = 0, error("\
+Error: -n, --follow, --index, --range, --checkpoint and --resume\n\
+cannot be used in pipelines");
+		return -1;
+	} else if (setup(stg_argi) < 0) {
+		return -1;
+	}
+	stg_nxt = nxt;
+	*args = stg_argi->args;
+	n = stg_argi->nargs;
+	stg_argi->nargs = 0U;
+	return n;
+}
+
+static void
+stg_stmt(const char *s, size_t z, const struct scan_s *x)
+{
+	if (bncw) {
+		wr_bnc(s, z);
+	} else {
+		wr_stmt(s, z);
+	}
+	if (stg_nxt != NULL) {
+		stg_nxt(s, z, x);
+	}
+	return;
+}
+
+static int
+stg_fini(void)
+{
+	int rc;
+
+	fini_proc();
+	rc = teardown();
+	yuck_free(stg_argi);
+	return rc;
+}
+
+const struct stage_s stage_ttl_split = {
+	"split", "ttl-split", ttl_split_main, stg_init, stg_stmt, stg_fini,
+};
+#endif	/* RDFSNIPS */
+
 /* ttl-split.c ends here */
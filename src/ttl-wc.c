@@ -37,12 +37,23 @@
 #if defined HAVE_CONFIG_H
 # include "config.h"
 #endif	/* HAVE_CONFIG_H */
+#include <stdlib.h>
 #include <unistd.h>
 #include <stdbool.h>
 #include <sys/mman.h>
+#include <sys/stat.h>
 #include <stdio.h>
 #include <string.h>
+#include <stdarg.h>
 #include <fcntl.h>
+#include <errno.h>
+#include "ttlidx.h"
+#include "scan.h"
+#include "range.h"
+#include "frame.h"
+#if defined RDFSNIPS
+# include "stage.h"
+#endif	/* RDFSNIPS */
 #include "nifty.h"
 
 #if !defined MAP_ANON && defined MAP_ANONYMOUS
@@ -59,8 +70,44 @@ static size_t nsub;
 static size_t npre;
 static size_t nobj;
 
+/* statement index, if requested */
+static size_t istrd;
+static ttlidx_t sidx;
+/* file offset of the current scan buffer */
+static size_t ioff;
+
+/* scanner state */
+static struct scan_s scn;
+
+/* byte range to count, if requested */
+static struct range_s rng;
+static bool rngp;
+
+/* whether the input is framed, -1 for don't know yet,
+ * 1 if there's still the magic to skip */
+static int frmi;
+/* only subjects are needed, frames needn't be scanned then */
+static bool subsp;
+
 
 /* helpers */
+static void
+__attribute__((format(printf, 1, 2)))
+error(const char *fmt, ...)
+{
+	va_list vap;
+	va_start(vap, fmt);
+	vfprintf(stderr, fmt, vap);
+	va_end(vap);
+	if (errno) {
+		fputc(':', stderr);
+		fputc(' ', stderr);
+		fputs(strerror(errno), stderr);
+	}
+	fputc('\n', stderr);
+	return;
+}
+
 static void*
 resz(void *buf, size_t old, size_t new)
 {
@@ -81,18 +128,45 @@ resz(void *buf, size_t old, size_t new)
 		_oz = _nuz_;						\
 	}
 
-static inline bool
-escapedp(const char *sp, const char *bp)
+
+/* indexing */
+static void
+idx_stmt(const char *s, size_t z, size_t off)
 {
-/* find out if sp is backslash-escaped
- * but backslash-escaped backslashes won't count,
- * so make sure the number of backslashes before sp is odd */
-	int bksl = 0;
+	if (scn.dirp && *s != '@') {
+		/* store sparql style directives in their turtle form */
+		char dir[4096U];
 
-	while (sp-- > bp && *sp == '\\') {
-		bksl ^= 1;
+		if ((z = scan_dir(dir, sizeof(dir), s, z))) {
+			ttlidx_add_dir(sidx, dir, z);
+		}
+	} else if (scn.dirp) {
+		ttlidx_add_dir(sidx, s, z);
+	} else {
+		ttlidx_add_stmt(sidx, off);
 	}
-	return bksl;
+	return;
+}
+
+static void
+idx_fini(const char *fn)
+{
+	static const char sfx[] = ".ttlidx";
+	char ifn[4096U];
+	struct stat st;
+
+	if (sidx == NULL) {
+		return;
+	}
+	snprintf(ifn, sizeof(ifn), "%s%s", fn, sfx);
+	if (stat(fn, &st) < 0) {
+		error("Error: cannot stat `%s', index not written", fn);
+	} else if (ttlidx_write(sidx, ifn, &st) < 0) {
+		error("Error: cannot write index `%s'", ifn);
+	}
+	free_ttlidx(sidx);
+	sidx = NULL;
+	return;
 }
 
 
@@ -107,138 +181,71 @@ init_proc(void)
 }
 
 static ssize_t
-proc(const char *buf, size_t bsz, bool only_subs_p)
+proc(const char *buf, size_t bsz, bool lastp)
 {
 	const char *sp = buf;
-	const char *const UNUSED(ep) = buf + bsz;
-	enum {
-		FREE,
-		IN_ANGLES,
-		IN_QUOTES,
-		IN_LONG_QUOTES,
-		IN_COMMENT,
-	} st = FREE;
+	const char *const ep = buf + bsz;
+	const char *bo;
 
 #define fini_proc()	proc(NULL, 0U, false)
-	if (UNLIKELY(bsz == 0U)) {
+	if (UNLIKELY(buf == NULL)) {
 		/* and finalise */
-		st = FREE;
+		memset(&scn, 0, sizeof(scn));
 		return 0;
 	}
 
-next:
-	/* overread whitespace */
-	for (; *sp > '\0' && *sp <= ' '; sp++);
-
-	/* statements are always concluded by . so look for that guy */
-	for (const char *eo, *tp = sp;
-	     ({
-		     switch (st) {
-		     case FREE:
-			     if (only_subs_p) {
-				     eo = strpbrk(tp, ".<\"#");
-			     } else {
-				     eo = strpbrk(tp, ".,;<\"#");
-			     }
-			     break;
-		     case IN_ANGLES:
-			     eo = strchr(tp, '>');
-			     break;
-		     case IN_QUOTES:
-			     eo = strchr(tp, '"');
-			     break;
-		     case IN_LONG_QUOTES:
-			     eo = strstr(tp, "\"\"\"");
-			     break;
-		     case IN_COMMENT:
-			     eo = strchr(tp, '\n');
-			     break;
-		     default:
-			     /* fuck */
-			     eo = NULL;
-			     break;
-		     }
-		     eo;
-	     }) != NULL; tp = eo) {
-		/* check character at point */
-		switch (*eo++) {
-		case '.':
-			if (LIKELY(*sp != '@')) {
-				/* don't count directives */
-				nsub++;
-				npre++;
-				nobj++;
-			}
-			sp = eo;
-			goto next;
-		case ';':
-			npre++;
-			nobj++;
-			break;
-		case ',':
-			nobj++;
-			break;
-		case '<':
-			/* find matching > */
-			st = IN_ANGLES;
-			break;
-		case '>':
-			/* yay, go back to free scan */
-			st = FREE;
-			break;
-		case '"':
-			/* skip this occurrence if it's an escaped " */
-			if (LIKELY(!escapedp(eo - 1, tp))) {
-				switch (st) {
-				case FREE:
-					/* check if it's a long quote (""") */
-					if (!eo[0U]) {
-						goto out;
-					} else if (eo[0U] != '"') {
-						st = IN_QUOTES;
-					} else if (!eo[1U]) {
-						goto out;
-					} else if (eo[1U] != '"') {
-						/* oh brill, we're through
-						 * already ... don't change
-						 * the state */
-						eo++;
-					} else {
-						st = IN_LONG_QUOTES;
-						eo += 2U;
-					}
-					break;
-				case IN_QUOTES:
-					st = FREE;
-					break;
-				case IN_LONG_QUOTES:
-					eo += 2U;
-					st = FREE;
-					break;
-				default:
-					/* huh? */
-					break;
-				}
-			}
-			break;
-		case '#':
-			assert(st == FREE);
-			st = IN_COMMENT;
-			break;
-		case '\n':
-			assert(st == IN_COMMENT);
-			st = FREE;
-			break;
-		default:
-			break;
+	for (const char *eo;
+	     (eo = (lastp ? scan_last : scan_stmt)(&scn, &bo, sp, ep)) != NULL;
+	     sp = eo) {
+		if (UNLIKELY(sidx != NULL)) {
+			idx_stmt(bo, eo - bo, ioff + (sp - buf));
+		}
+		if (LIKELY(!scn.dirp)) {
+			/* don't count directives */
+			nsub++;
+			npre += scn.nsemi + 1U;
+			nobj += scn.nsemi + scn.ncomma + 1U;
 		}
 	}
-out:
+	return bo - buf;
+}
+
+static ssize_t
+proc_frm(const char *buf, size_t bsz, bool lastp)
+{
+/* like proc() but for framed input */
+	const char *sp = buf;
+	const char *const ep = buf + bsz;
+	struct frame_s f;
+
+	if (UNLIKELY(frmi == 1)) {
+		sp += FRAME_MAGIC_LEN;
+		frmi = 2;
+	}
+	for (const char *eo; (eo = frame_get(&f, sp, ep)) != NULL; sp = eo) {
+		const char *bo;
+
+		if (f.dirp) {
+			continue;
+		}
+		nsub++;
+		npre++;
+		nobj++;
+		if (!subsp && scan_last(&scn, &bo, f.s, f.s + f.z) != NULL) {
+			/* frames hold exactly one statement */
+			npre += scn.nsemi;
+			nobj += scn.nsemi + scn.ncomma;
+		}
+		memset(&scn, 0, sizeof(scn));
+	}
+	if (UNLIKELY(lastp && sp < ep)) {
+		errno = 0, error("Warning: input ends inside a frame");
+	}
 	return sp - buf;
 }
 
 static int
-count1(const char *fn, bool only_subs_p)
+count1(const char *fn)
 {
 	static char _buf[4096U];
 	char *buf = _buf;
@@ -253,13 +260,27 @@ count1(const char *fn, bool only_subs_p)
 	}
 	/* initialise counters */
 	init_proc();
+	if (istrd && fn != NULL) {
+		sidx = make_ttlidx(istrd);
+	}
 	/* read into buf */
 	bix = 0U;
+	ioff = 0U;
+	frmi = -1;
 	for (ssize_t nrd, npr;
 	     (nrd = read(fd, buf + bix, bsz - bix - 1U/*\nul*/)) > 0;) {
 		/* mark the end of the buffer */
 		buf[bix += nrd] = '\0';
-		if ((npr = proc(buf, bix, only_subs_p)) < 0) {
+		if (UNLIKELY(frmi < 0) && (frmi = frame_magicp(buf, bix)) < 0) {
+			/* can't tell yet whether it's framed */
+			continue;
+		} else if (UNLIKELY(frmi == 1 && sidx != NULL)) {
+			errno = 0, error("\
+Warning: no index for framed input");
+			free_ttlidx(sidx);
+			sidx = NULL;
+		}
+		if ((npr = (frmi ? proc_frm : proc)(buf, bix, false)) < 0) {
 			goto fuck;
 		} else if (npr == 0 && bix + 1 >= bsz) {
 			/* need a bigger buffer */
@@ -270,20 +291,28 @@ count1(const char *fn, bool only_subs_p)
 		} else if (npr == 0) {
 			/* just read some more */
 			;
-		} else if ((bix -= npr) > 0) {
-			/* memmove to the front */
-			memmove(buf, buf + npr, bix);
+		} else {
+			ioff += npr;
+			if ((bix -= npr) > 0) {
+				/* memmove to the front */
+				memmove(buf, buf + npr, bix);
+			}
 		}
 	}
 	/* finalise buffer again, just in case */
 	buf[bix] = '\0';
 	/* last try, we don't care how much gets processed */
-	(void)proc(buf, bix, only_subs_p);
+	(void)(frmi > 0 ? proc_frm : proc)(buf, bix, true);
 	/* finalise processing */
 	fini_proc();
+	idx_fini(fn);
 
 fuck:
 	/* resource freeing */
+	if (sidx != NULL) {
+		free_ttlidx(sidx);
+		sidx = NULL;
+	}
 	close(fd);
 	if (buf != _buf) {
 		munmap(buf, bsz);
@@ -291,6 +320,33 @@ fuck:
 	return 0;
 }
 
+static int
+range1(const char *fn)
+{
+	struct rmap_s r;
+
+	if (range_map(&r, fn, rng, false) < 0) {
+		if (errno == ESPIPE) {
+			errno = 0, error("Error: --range needs a regular file");
+		} else {
+			error("Error: cannot open file `%s'", fn);
+		}
+		return -1;
+	} else if (frame_magicp(r.m, r.mz) > 0) {
+		errno = 0, error("Error: --range needs turtle input");
+		range_unmap(&r);
+		return -1;
+	}
+	/* initialise counters, directives needn't be seen */
+	init_proc();
+	if (r.end > r.beg) {
+		(void)proc(r.m + r.beg, r.end - r.beg, true);
+	}
+	fini_proc();
+	range_unmap(&r);
+	return 0;
+}
+
 
 #include "ttl-wc.yucc"
 
@@ -337,8 +393,13 @@ pr_fn:
 	return;
 }
 
+#if !defined RDFSNIPS
 int
 main(int argc, char *argv[])
+#else  /* RDFSNIPS */
+static int
+ttl_wc_main(int argc, char *argv[])
+#endif	/* !RDFSNIPS */
 {
 	yuck_t argi[1U];
 	int rc = 0;
@@ -349,12 +410,35 @@ main(int argc, char *argv[])
 		goto out;
 	}
 
+	if (argi->index_arg == YUCK_OPTARG_NONE) {
+		istrd = 1000U;
+	} else if (argi->index_arg) {
+		istrd = strtoul(argi->index_arg, NULL, 0);
+	}
+
+	if (argi->range_arg) {
+		if (range_parse(&rng, argi->range_arg) < 0) {
+			errno = 0, error("\
+Error: cannot parse range `%s', must be START:END", argi->range_arg);
+			rc = 1;
+			goto out;
+		} else if (istrd) {
+			errno = 0, error("\
+Error: --index needs the whole file, not a range");
+			rc = 1;
+			goto out;
+		}
+		rngp = true;
+	}
+
+	subsp = argi->subjects_flag;
+
 	if (argi->nargs == 0U) {
 		goto one;
 	}
 	for (; i < argi->nargs; i++) {
 	one:
-		rc -= count1(argi->args[i], !!argi->subjects_flag);
+		rc -= !rngp ? count1(argi->args[i]) : range1(argi->args[i]);
 		pr_counts(argi, argi->args[i]);
 	}
 	if (i > 1U) {
@@ -367,4 +451,58 @@ out:
 	return rc;
 }
 
+#if defined RDFSNIPS
+/* as a stage of a fused pipeline */
+static yuck_t stg_argi[1U];
+static stage_stmt_f stg_nxt;
+
+static int
+stg_init(int argc, char *argv[], stage_stmt_f nxt, char ***args)
+{
+	int n;
+
+	if (yuck_parse(stg_argi, argc, argv) < 0) {
+		return -1;
+	} else if (stg_argi->index_arg || stg_argi->range_arg) {
+		errno = 0, error("\
+Error: --index and --range cannot be used in pipelines");
+		return -1;
+	}
+	subsp = stg_argi->subjects_flag;
+	stg_nxt = nxt;
+	init_proc();
+	/* files are the driver's business, we count them as one */
+	*args = stg_argi->args;
+	n = stg_argi->nargs;
+	stg_argi->nargs = 0U;
+	return n;
+}
+
+static void
+stg_stmt(const char *s, size_t z, const struct scan_s *x)
+{
+	if (!x->dirp) {
+		nsub++;
+		npre += x->nsemi + 1U;
+		nobj += x->nsemi + x->ncomma + 1U;
+	}
+	if (stg_nxt != NULL) {
+		stg_nxt(s, z, x);
+	}
+	return;
+}
+
+static int
+stg_fini(void)
+{
+	pr_counts(stg_argi, NULL);
+	yuck_free(stg_argi);
+	return 0;
+}
+
+const struct stage_s stage_ttl_wc = {
+	"wc", "ttl-wc", ttl_wc_main, stg_init, stg_stmt, stg_fini,
+};
+#endif	/* RDFSNIPS */
+
 /* ttl-wc.c ends here */
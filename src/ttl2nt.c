@@ -0,0 +1,1176 @@
+/*** ttl2nt.c -- expand turtle into n-triples
+ *
+ * Copyright (C) 2026 Sebastian Freundt
+ *
+ * Author:  Sebastian Freundt <freundt@ga-group.nl>
+ *
+ * This file is part of rdfsnips.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the author nor the names of any contributors
+ *    may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED.  IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ ***/
+#if defined HAVE_CONFIG_H
+# include "config.h"
+#endif	/* HAVE_CONFIG_H */
+#include <stdlib.h>
+#include <unistd.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <sys/mman.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdarg.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <pthread.h>
+#include "scan.h"
+#include "term.h"
+#include "frame.h"
+#include "pool.h"
+#include "obuf.h"
+#include "nifty.h"
+
+#if !defined MAP_ANON && defined MAP_ANONYMOUS
+# define MAP_ANON	MAP_ANONYMOUS
+#elif !defined MAP_ANON
+# define MAP_ANON	(0x1000U)
+#endif	/* !MAP_ANON */
+#define PROT_RW		(PROT_READ | PROT_WRITE)
+#define MAP_MEM		(MAP_PRIVATE | MAP_ANON)
+
+#define RDF		"http://www.w3.org/1999/02/22-rdf-syntax-ns#"
+#define XSD		"http://www.w3.org/2001/XMLSchema#"
+#define IRI(x)		"<" x ">"
+
+/* output is handed to the output buffer once it's grown this large */
+#define OUTZ		(64U * 1024U)
+
+/* growing buffer */
+struct sink_s {
+	char *b;
+	size_t z;
+	size_t n;
+	bool oomp;
+};
+
+/* expansion state, one per thread */
+struct xpnd_s {
+	/* the triples */
+	struct sink_s o;
+	/* expanded terms, used like a stack */
+	struct sink_s t;
+	/* ordinal of the statement, and the number of blank nodes handed
+	 * out for it so far, together they make fresh blank node labels */
+	size_t stmt;
+	size_t nbn;
+	/* index of the prefix last looked up, runs of the same prefix
+	 * are common */
+	size_t lastp;
+};
+
+struct pfx_s {
+	char *p;
+	size_t pz;
+	char *i;
+	size_t iz;
+};
+
+/* scanner state */
+static struct scan_s scn;
+
+/* whether the input is framed, -1 for don't know yet,
+ * 1 if there's still the magic to skip */
+static int frmi;
+
+/* prefixes in use and a hash table over their names,
+ * slots hold indices into pres plus 1 */
+static struct pfx_s *pres;
+static size_t npres;
+static size_t zpres;
+static size_t *pht;
+static size_t zpht;
+
+/* the current base, NULL if there's none */
+static char *base;
+static size_t basez;
+
+/* ordinal of the next statement */
+static size_t nstmt;
+/* number of statements that couldn't be expanded */
+static size_t nbad;
+
+/* single-threaded expansion */
+static struct xpnd_s xp;
+
+/* buffered stdout */
+static obuf_t sob;
+
+
+/* helpers */
+static void
+__attribute__((format(printf, 1, 2)))
+error(const char *fmt, ...)
+{
+	va_list vap;
+	va_start(vap, fmt);
+	vfprintf(stderr, fmt, vap);
+	va_end(vap);
+	if (errno) {
+		fputc(':', stderr);
+		fputc(' ', stderr);
+		fputs(strerror(errno), stderr);
+	}
+	fputc('\n', stderr);
+	return;
+}
+
+static void*
+resz(void *buf, size_t old, size_t new)
+{
+	void *nub = mmap(NULL, new, PROT_RW, MAP_MEM, -1, 0);
+
+	if (UNLIKELY(nub == MAP_FAILED)) {
+		return NULL;
+	}
+	(void)memcpy(nub, buf, old);
+	return nub;
+}
+
+#define RESZ(_b, _oz, _nz)						\
+	size_t _nuz_ = _nz;						\
+	void *_nub_ = resz(_b, _oz, _nuz_);				\
+	if (LIKELY(_nub_ != NULL)) {					\
+		_b = _nub_;						\
+		_oz = _nuz_;						\
+	}
+
+static inline size_t
+next_2pow(size_t x)
+{
+	x--;
+	x |= x >> 1U;
+	x |= x >> 2U;
+	x |= x >> 4U;
+	x |= x >> 8U;
+	x |= x >> 16U;
+	x |= x >> 32U;
+	return ++x;
+}
+
+static __attribute__((noinline)) bool
+grow(struct sink_s *o, size_t z)
+{
+	const size_t nuz = next_2pow(o->n + z);
+	char *nub = realloc(o->b, nuz > 4096U ? nuz : 4096U);
+
+	if (UNLIKELY(nub == NULL)) {
+		o->oomp = true;
+		return false;
+	}
+	o->b = nub;
+	o->z = nuz > 4096U ? nuz : 4096U;
+	return true;
+}
+
+static inline void
+put(struct sink_s *o, const char *s, size_t z)
+{
+	if (UNLIKELY(o->n + z > o->z) && !grow(o, z)) {
+		return;
+	}
+	memcpy(o->b + o->n, s, z);
+	o->n += z;
+	return;
+}
+
+static inline void
+putc1(struct sink_s *o, char c)
+{
+	if (UNLIKELY(o->n >= o->z) && !grow(o, 1U)) {
+		return;
+	}
+	o->b[o->n++] = c;
+	return;
+}
+
+#define PUTS(o, lit)	put(o, lit, sizeof(lit) - 1U)
+
+
+/* prefixes and base */
+static inline size_t
+hash(const char *s, size_t z)
+{
+	/* FNV-1a */
+	uint_fast32_t h = 2166136261U;
+
+	for (size_t i = 0U; i < z; i++) {
+		h ^= (unsigned char)s[i];
+		h *= 16777619U;
+	}
+	return h;
+}
+
+static const struct pfx_s*
+get_prefix(const char *p, size_t pz)
+{
+	if (UNLIKELY(!zpht)) {
+		return NULL;
+	}
+	for (size_t h = hash(p, pz), k; (k = pht[h &= zpht - 1U]); h++) {
+		const struct pfx_s *x = pres + k - 1U;
+
+		if (x->pz == pz && !memcmp(x->p, p, pz)) {
+			return x;
+		}
+	}
+	return NULL;
+}
+
+static void
+pht_put(size_t k)
+{
+	const struct pfx_s *x = pres + k;
+	size_t h = hash(x->p, x->pz);
+
+	for (; pht[h &= zpht - 1U]; h++);
+	pht[h] = k + 1U;
+	return;
+}
+
+static int
+add_prefix(const char *p, size_t pz, const char *i, size_t iz)
+{
+	struct pfx_s *x = deconst(get_prefix(p, pz));
+	char *nui;
+
+	if ((nui = malloc(iz + 1U)) == NULL) {
+		return -1;
+	}
+	memcpy(nui, i, iz);
+	nui[iz] = '\0';
+	if (x != NULL) {
+		/* redefinition */
+		free(x->i);
+		x->i = nui;
+		x->iz = iz;
+		return 0;
+	}
+	if (npres >= zpres) {
+		const size_t nuz = zpres ? zpres << 1U : 64U;
+		struct pfx_s *nup = realloc(pres, nuz * sizeof(*pres));
+
+		if (UNLIKELY(nup == NULL)) {
+			free(nui);
+			return -1;
+		}
+		pres = nup;
+		zpres = nuz;
+	}
+	if (2U * (npres + 1U) > zpht) {
+		/* rehash */
+		const size_t nuz = zpht ? zpht << 1U : 128U;
+		size_t *nuh = calloc(nuz, sizeof(*pht));
+
+		if (UNLIKELY(nuh == NULL)) {
+			free(nui);
+			return -1;
+		}
+		free(pht);
+		pht = nuh;
+		zpht = nuz;
+		for (size_t k = 0U; k < npres; k++) {
+			pht_put(k);
+		}
+	}
+	if ((x = pres + npres)->p = malloc(pz + 1U), x->p == NULL) {
+		free(nui);
+		return -1;
+	}
+	memcpy(x->p, p, pz);
+	x->p[pz] = '\0';
+	x->pz = pz;
+	x->i = nui;
+	x->iz = iz;
+	pht_put(npres++);
+	return 0;
+}
+
+static void
+clr_prefixes(void)
+{
+	for (size_t k = 0U; k < npres; k++) {
+		free(pres[k].p);
+		free(pres[k].i);
+	}
+	npres = 0U;
+	if (pht != NULL) {
+		memset(pht, 0, zpht * sizeof(*pht));
+	}
+	free(base);
+	base = NULL;
+	basez = 0U;
+	return;
+}
+
+static bool
+absp(const char *s, size_t z)
+{
+/* whether IRI S of length Z has a scheme */
+	size_t i = 0U;
+
+	if (!z || !((*s | 0x20) >= 'a' && (*s | 0x20) <= 'z')) {
+		return false;
+	}
+	for (i = 1U; i < z; i++) {
+		switch (s[i]) {
+		case 'a' ... 'z':
+		case 'A' ... 'Z':
+		case '0' ... '9':
+		case '+':
+		case '-':
+		case '.':
+			continue;
+		case ':':
+			return true;
+		default:
+			return false;
+		}
+	}
+	return false;
+}
+
+static void
+resolve(struct sink_s *o, const char *s, size_t z)
+{
+/* append IRI S of length Z to O, resolved against the base, this
+ * follows RFC 3986 except that dot segments are left alone, a base
+ * without a scheme leaves S alone too */
+	const char *c;
+	size_t bz;
+
+	if (base == NULL || absp(s, z) ||
+	    UNLIKELY((c = memchr(base, ':', basez)) == NULL)) {
+		put(o, s, z);
+		return;
+	}
+	/* find the portion of the base to keep */
+	if (z >= 2U && s[0U] == '/' && s[1U] == '/') {
+		/* network path, keep the scheme */
+		bz = c - base + 1U;
+	} else if (z && s[0U] == '/') {
+		/* absolute path, keep scheme and authority */
+		const char *a = c;
+
+		if (a + 2 < base + basez && a[1U] == '/' && a[2U] == '/') {
+			a += 3U;
+			a += strcspn(a, "/?#");
+		} else {
+			a++;
+		}
+		bz = a - base;
+	} else if (z && s[0U] == '#') {
+		bz = strcspn(base, "#");
+	} else if (z && s[0U] == '?') {
+		bz = strcspn(base, "?#");
+	} else if (!z) {
+		bz = strcspn(base, "#");
+	} else {
+		/* relative path, keep everything up to the last slash */
+		bz = strcspn(base, "?#");
+		while (bz > 0U && base[bz - 1U] != '/') {
+			bz--;
+		}
+		if (!bz) {
+			bz = c - base + 1U;
+		}
+	}
+	put(o, base, bz);
+	put(o, s, z);
+	return;
+}
+
+static int
+dir1(const char *s, size_t z)
+{
+/* process directive S of length Z */
+	char d[4096U];
+	const char *sp, *ep, *i;
+	struct sink_s r = {NULL};
+	int rc = -1;
+
+	if (*s != '@') {
+		/* sparql style, make it turtle */
+		if (!(z = scan_dir(d, sizeof(d), s, z))) {
+			return -1;
+		}
+		s = d;
+	}
+	ep = s + z;
+	if (z > 7U && !memcmp(s, "@prefix", 7U)) {
+		const char *p = term_skip(s + 7U, ep);
+		const char *c = memchr(p, ':', ep - p);
+
+		if (c == NULL) {
+			return -1;
+		}
+		sp = term_skip(c + 1U, ep);
+		if (sp >= ep || *sp != '<' ||
+		    (i = memchr(sp, '>', ep - sp)) == NULL) {
+			return -1;
+		}
+		resolve(&r, sp + 1U, i - sp - 1U);
+		if (!r.oomp) {
+			rc = add_prefix(p, c - p, r.b ?: "", r.n);
+		}
+	} else if (z > 5U && !memcmp(s, "@base", 5U)) {
+		sp = term_skip(s + 5U, ep);
+		if (sp >= ep || *sp != '<' ||
+		    (i = memchr(sp, '>', ep - sp)) == NULL) {
+			return -1;
+		}
+		resolve(&r, sp + 1U, i - sp - 1U);
+		putc1(&r, '\0');
+		if (r.oomp) {
+			;
+		} else if (UNLIKELY(!absp(r.b, r.n - 1U))) {
+			/* nothing to resolve against */
+			errno = 0, error("\
+Warning: ignoring base `%.*s' without a scheme", (int)(i - sp - 1), sp + 1U);
+		} else {
+			free(base);
+			base = r.b;
+			basez = r.n - 1U;
+			return 0;
+		}
+	}
+	free(r.b);
+	return rc;
+}
+
+
+/* expansion, terms go onto the stack in X->t in their n-triples form,
+ * triples out to X->o */
+static const char *xp_term(struct xpnd_s *x, const char *s, const char *e);
+
+static void
+xp_triple(struct xpnd_s *x, size_t s, size_t sz, size_t p, size_t pz, size_t o)
+{
+	const char *t = x->t.b;
+	const size_t oz = x->t.n - o;
+	struct sink_s *r = &x->o;
+
+	if (UNLIKELY(r->n + sz + pz + oz + 4U > r->z) &&
+	    !grow(r, sz + pz + oz + 4U)) {
+		return;
+	}
+	/* we made room for everything */
+	memcpy(r->b + r->n, t + s, sz);
+	r->b[r->n += sz] = ' ';
+	memcpy(r->b + ++r->n, t + p, pz);
+	r->b[r->n += pz] = ' ';
+	memcpy(r->b + ++r->n, t + o, oz);
+	r->n += oz;
+	memcpy(r->b + r->n, " .\n", 3U);
+	r->n += 3U;
+	return;
+}
+
+static void
+xp_bnode(struct xpnd_s *x)
+{
+/* push a fresh blank node */
+	char lbl[64U];
+
+	put(&x->t, lbl, snprintf(lbl, sizeof(lbl), "_:g%zu_%zu",
+				  x->stmt, x->nbn++));
+	return;
+}
+
+static const char*
+xp_iri(struct xpnd_s *x, const char *s, const char *e)
+{
+/* push IRI or prefixed name S */
+	const char *c;
+
+	if (*s == '<') {
+		const char *i;
+
+		if ((i = memchr(s, '>', e - s)) == NULL) {
+			return NULL;
+		} else if (LIKELY(base == NULL)) {
+			put(&x->t, s, i + 1U - s);
+		} else {
+			putc1(&x->t, '<');
+			resolve(&x->t, s + 1U, i - s - 1U);
+			putc1(&x->t, '>');
+		}
+		return i + 1U;
+	}
+	/* prefixed name then */
+	e = term_end(s, e);
+	if ((c = memchr(s, ':', e - s)) == NULL) {
+		return NULL;
+	}
+	with (const struct pfx_s *p = pres + x->lastp) {
+		if (x->lastp >= npres || p->pz != (size_t)(c - s) ||
+		    memcmp(p->p, s, p->pz)) {
+			if (UNLIKELY((p = get_prefix(s, c - s)) == NULL)) {
+				return NULL;
+			}
+			x->lastp = p - pres;
+		}
+		putc1(&x->t, '<');
+		put(&x->t, p->i, p->iz);
+	}
+	/* local part, with escapes removed */
+	for (const char *b = ++c, *bs;; c = bs + 2U) {
+		if ((bs = memchr(c, '\\', e - c)) == NULL) {
+			put(&x->t, b, e - b);
+			break;
+		}
+		put(&x->t, b, bs - b);
+		if (bs + 1 < e) {
+			putc1(&x->t, bs[1U]);
+		}
+		b = bs + 2U;
+		if (b >= e) {
+			break;
+		}
+	}
+	putc1(&x->t, '>');
+	return e;
+}
+
+static const char*
+xp_lit(struct xpnd_s *x, const char *s, const char *e)
+{
+	const char q = *s;
+	const bool longp = s + 2 < e && s[1U] == q && s[2U] == q;
+	const char *b = s + 1U + 2U * longp;
+	const char *c;
+
+	/* find the closing quote */
+	for (c = b; c < e; c++) {
+		if (*c == '\\') {
+			c++;
+		} else if (*c == q &&
+			   (!longp || c + 2 < e && c[1U] == q && c[2U] == q)) {
+			break;
+		}
+	}
+	if (c >= e) {
+		return NULL;
+	}
+	if (LIKELY(q == '"' && !longp)) {
+		/* already in n-triples form */
+		put(&x->t, s, c + 1U - s);
+	} else {
+		/* escape what needs escaping */
+		putc1(&x->t, '"');
+		for (const char *p = b; p < c; p++) {
+			switch (*p) {
+			case '\\':
+				put(&x->t, p++, 2U);
+				break;
+			case '"':
+				PUTS(&x->t, "\\\"");
+				break;
+			case '\n':
+				PUTS(&x->t, "\\n");
+				break;
+			case '\r':
+				PUTS(&x->t, "\\r");
+				break;
+			default:
+				putc1(&x->t, *p);
+				break;
+			}
+		}
+		putc1(&x->t, '"');
+	}
+	s = c + 1U + 2U * longp;
+	if (s < e && *s == '@') {
+		/* language tag */
+		const char *t = term_end(s + 1U, e);
+
+		put(&x->t, s, t - s);
+		return t;
+	} else if (s + 1 < e && s[0U] == '^' && s[1U] == '^') {
+		PUTS(&x->t, "^^");
+		return xp_iri(x, s + 2U, e);
+	}
+	return s;
+}
+
+static const char*
+xp_pol(struct xpnd_s *x, size_t s, size_t sz, const char *sp, const char *e)
+{
+/* expand the predicate-object list at SP for the subject at S of
+ * length SZ, return a pointer to the closing `.' or `]' */
+	const size_t m = x->t.n;
+
+	for (sp = term_skip(sp, e); sp < e && *sp != '.' && *sp != ']';) {
+		const size_t p = x->t.n;
+		size_t pz;
+
+		if (*sp == 'a' && (sp + 1 >= e || (unsigned char)sp[1U] <= ' ' ||
+				   sp[1U] == '<' || sp[1U] == '"')) {
+			PUTS(&x->t, IRI(RDF "type"));
+			sp++;
+		} else if ((sp = xp_iri(x, sp, e)) == NULL) {
+			return NULL;
+		}
+		pz = x->t.n - p;
+		do {
+			const size_t o = x->t.n;
+
+			sp = term_skip(sp, e);
+			if ((sp = xp_term(x, sp, e)) == NULL) {
+				return NULL;
+			}
+			xp_triple(x, s, sz, p, pz, o);
+			/* forget about the object */
+			x->t.n = o;
+			sp = term_skip(sp, e);
+		} while (sp < e && *sp == ',' && sp++);
+		x->t.n = m;
+
+		if (sp < e && *sp == ';') {
+			do {
+				sp = term_skip(sp + 1U, e);
+			} while (sp < e && *sp == ';');
+		} else {
+			break;
+		}
+	}
+	return sp < e && (*sp == '.' || *sp == ']') ? sp : NULL;
+}
+
+static const char*
+xp_coll(struct xpnd_s *x, const char *s, const char *e)
+{
+/* push the head of collection S, its rdf:first/rdf:rest triples go out,
+ * the head stays at the bottom, the current node right above it */
+	const size_t h = x->t.n;
+	size_t c, cz, hz;
+
+	if ((s = term_skip(s + 1U, e)) < e && *s == ')') {
+		PUTS(&x->t, IRI(RDF "nil"));
+		return s + 1U;
+	}
+	xp_bnode(x);
+	c = h;
+	cz = hz = x->t.n - h;
+	while (s < e) {
+		const size_t p = x->t.n;
+		size_t o;
+
+		PUTS(&x->t, IRI(RDF "first"));
+		o = x->t.n;
+		if ((s = xp_term(x, s, e)) == NULL) {
+			return NULL;
+		}
+		xp_triple(x, c, cz, p, o - p, o);
+		x->t.n = p;
+
+		PUTS(&x->t, IRI(RDF "rest"));
+		o = x->t.n;
+		if ((s = term_skip(s, e)) < e && *s == ')') {
+			PUTS(&x->t, IRI(RDF "nil"));
+			xp_triple(x, c, cz, p, o - p, o);
+			x->t.n = h + hz;
+			return s + 1U;
+		}
+		xp_bnode(x);
+		xp_triple(x, c, cz, p, o - p, o);
+		/* the new node becomes the current one */
+		cz = x->t.n - o;
+		c = h + hz;
+		memmove(x->t.b + c, x->t.b + o, cz);
+		x->t.n = c + cz;
+	}
+	return NULL;
+}
+
+static const char*
+xp_anon(struct xpnd_s *x, const char *s, const char *e)
+{
+/* push a blank node for property list S, its triples go out */
+	const size_t b = x->t.n;
+
+	xp_bnode(x);
+	if ((s = term_skip(s + 1U, e)) < e && *s == ']') {
+		return s + 1U;
+	} else if ((s = xp_pol(x, b, x->t.n - b, s, e)) == NULL ||
+		   *s != ']') {
+		return NULL;
+	}
+	return s + 1U;
+}
+
+static const char*
+xp_term(struct xpnd_s *x, const char *s, const char *e)
+{
+/* push term S in its n-triples form, return a pointer past it */
+	const char *t;
+	size_t tz;
+
+	if (UNLIKELY(s >= e)) {
+		return NULL;
+	}
+	switch (*s) {
+	case '<':
+		return xp_iri(x, s, e);
+	case '"':
+	case '\'':
+		return xp_lit(x, s, e);
+	case '[':
+		return xp_anon(x, s, e);
+	case '(':
+		return xp_coll(x, s, e);
+	default:
+		break;
+	}
+	t = term_end(s, e);
+	if (UNLIKELY((tz = t - s) == 0U)) {
+		return NULL;
+	}
+	switch (*s) {
+	case '_':
+		if (tz > 2U && s[1U] == ':') {
+			/* blank node label */
+			put(&x->t, s, tz);
+			return t;
+		}
+		break;
+	case '0' ... '9':
+	case '+':
+	case '-':
+	case '.':
+		putc1(&x->t, '"');
+		put(&x->t, s, tz);
+		if (memchr(s, 'e', tz) || memchr(s, 'E', tz)) {
+			PUTS(&x->t, "\"^^" IRI(XSD "double"));
+		} else if (memchr(s, '.', tz)) {
+			PUTS(&x->t, "\"^^" IRI(XSD "decimal"));
+		} else {
+			PUTS(&x->t, "\"^^" IRI(XSD "integer"));
+		}
+		return t;
+	case 't':
+	case 'f':
+		if (tz == 4U && !memcmp(s, "true", 4U) ||
+		    tz == 5U && !memcmp(s, "false", 5U)) {
+			putc1(&x->t, '"');
+			put(&x->t, s, tz);
+			PUTS(&x->t, "\"^^" IRI(XSD "boolean"));
+			return t;
+		}
+		break;
+	default:
+		break;
+	}
+	return xp_iri(x, s, e);
+}
+
+static int
+xp_stmt(struct xpnd_s *x, const char *s, size_t z)
+{
+/* expand statement S of length Z into triples, all or nothing */
+	const char *const e = s + z;
+	const size_t on = x->o.n;
+	const char *sp;
+
+	x->t.n = 0U;
+	x->nbn = 0U;
+	if ((sp = xp_term(x, term_skip(s, e), e)) == NULL ||
+	    (sp = xp_pol(x, 0U, x->t.n, sp, e)) == NULL || *sp != '.' ||
+	    UNLIKELY(x->o.oomp || x->t.oomp)) {
+		x->o.n = on;
+		x->o.oomp = x->t.oomp = false;
+		return -1;
+	}
+	return 0;
+}
+
+
+/* parallel expansion, batches of statements go out to the workers
+ * and their triples are written in input order, the prefix table is
+ * read-only while batches are out and only changes after all of them
+ * are back, see jobs_drain() */
+#define BTCH_SIZE	(256U * 1024U)
+
+struct btch_s {
+	/* statements back to back, and the offset past each one */
+	char *ib;
+	size_t ibz;
+	size_t nib;
+	size_t *ie;
+	size_t iez;
+	size_t nie;
+	/* ordinal of the first statement */
+	size_t st0;
+	/* the triples and statements that couldn't be expanded */
+	struct xpnd_s x;
+	size_t nbad;
+	bool donep;
+};
+
+static pool_t jobs;
+/* ring of batches, BHD is the oldest one out, NBO the number out,
+ * the one after those is being filled */
+static struct btch_s *btch;
+static size_t nbtch;
+static size_t bhd;
+static size_t nbo;
+static pthread_mutex_t bmtx = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t bcnd = PTHREAD_COND_INITIALIZER;
+
+static void
+btch_work(void *clo)
+{
+	struct btch_s *b = clo;
+	size_t nb = 0U;
+
+	b->x.o.n = 0U;
+	for (size_t i = 0U, o = 0U; i < b->nie; o = b->ie[i++]) {
+		b->x.stmt = b->st0 + i;
+		nb += xp_stmt(&b->x, b->ib + o, b->ie[i] - o) < 0;
+	}
+
+	pthread_mutex_lock(&bmtx);
+	b->nbad = nb;
+	b->donep = true;
+	pthread_cond_broadcast(&bcnd);
+	pthread_mutex_unlock(&bmtx);
+	return;
+}
+
+static void
+jobs_out1(void)
+{
+/* wait for the oldest batch and write it out */
+	struct btch_s *b = btch + bhd;
+
+	pthread_mutex_lock(&bmtx);
+	while (!b->donep) {
+		pthread_cond_wait(&bcnd, &bmtx);
+	}
+	pthread_mutex_unlock(&bmtx);
+
+	obuf_write(sob, b->x.o.b, b->x.o.n);
+	nbad += b->nbad;
+	b->nib = b->nie = 0U;
+	b->donep = false;
+	bhd = (bhd + 1U) % nbtch;
+	nbo--;
+	return;
+}
+
+static void
+jobs_send(void)
+{
+/* send the batch being filled off to the workers */
+	struct btch_s *b = btch + (bhd + nbo) % nbtch;
+
+	if (!b->nie) {
+		return;
+	}
+	nbo++;
+	pool_push(jobs, btch_work, b);
+	if (nbo >= nbtch) {
+		/* keep one for filling */
+		jobs_out1();
+	}
+	return;
+}
+
+static void
+jobs_drain(void)
+{
+	jobs_send();
+	while (nbo) {
+		jobs_out1();
+	}
+	return;
+}
+
+static int
+jobs_add(const char *s, size_t z)
+{
+	struct btch_s *b = btch + (bhd + nbo) % nbtch;
+
+	if (b->nib + z > BTCH_SIZE && b->nie) {
+		jobs_send();
+		b = btch + (bhd + nbo) % nbtch;
+	}
+	if (UNLIKELY(b->nib + z > b->ibz)) {
+		const size_t nuz = next_2pow(b->nib + z);
+		char *nub = realloc(b->ib, nuz);
+
+		if (UNLIKELY(nub == NULL)) {
+			return -1;
+		}
+		b->ib = nub;
+		b->ibz = nuz;
+	}
+	if (UNLIKELY(b->nie >= b->iez)) {
+		const size_t nuz = b->iez ? b->iez << 1U : 1024U;
+		size_t *nue = realloc(b->ie, nuz * sizeof(*b->ie));
+
+		if (UNLIKELY(nue == NULL)) {
+			return -1;
+		}
+		b->ie = nue;
+		b->iez = nuz;
+	}
+	if (!b->nie) {
+		b->st0 = nstmt;
+	}
+	memcpy(b->ib + b->nib, s, z);
+	b->ie[b->nie++] = b->nib += z;
+	return 0;
+}
+
+static int
+init_jobs(unsigned int nj)
+{
+	if (!nj) {
+		long int ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+		nj = ncpu > 0 ? (unsigned int)ncpu : 1U;
+	}
+	nbtch = 2U * nj + 1U;
+	if (UNLIKELY((btch = calloc(nbtch, sizeof(*btch))) == NULL)) {
+		return -1;
+	} else if (UNLIKELY((jobs = make_pool(nj, 0U)) == NULL)) {
+		free(btch);
+		btch = NULL;
+		return -1;
+	}
+	return 0;
+}
+
+static void
+fini_jobs(void)
+{
+	if (jobs == NULL) {
+		return;
+	}
+	free_pool(jobs);
+	jobs = NULL;
+	for (size_t i = 0U; i < nbtch; i++) {
+		free(btch[i].ib);
+		free(btch[i].ie);
+		free(btch[i].x.o.b);
+		free(btch[i].x.t.b);
+	}
+	free(btch);
+	btch = NULL;
+	return;
+}
+
+
+static void
+stmt1(const char *s, size_t z, bool dirp)
+{
+	if (dirp) {
+		if (jobs != NULL) {
+			jobs_drain();
+		}
+		nbad += dir1(s, z) < 0;
+		return;
+	} else if (jobs != NULL) {
+		nbad += jobs_add(s, z) < 0;
+		nstmt++;
+		return;
+	}
+	xp.stmt = nstmt++;
+	nbad += xp_stmt(&xp, s, z) < 0;
+	if (xp.o.n >= OUTZ) {
+		obuf_write(sob, xp.o.b, xp.o.n);
+		xp.o.n = 0U;
+	}
+	return;
+}
+
+static ssize_t
+proc(const char *buf, size_t bsz, bool lastp)
+{
+	const char *sp = buf;
+	const char *const ep = buf + bsz;
+	const char *bo;
+
+	for (const char *eo;
+	     (eo = (lastp ? scan_last : scan_stmt)(&scn, &bo, sp, ep)) != NULL;
+	     sp = eo) {
+		stmt1(bo, eo - bo, scn.dirp);
+	}
+	return bo - buf;
+}
+
+static ssize_t
+proc_frm(const char *buf, size_t bsz, bool lastp)
+{
+/* like proc() but for framed input */
+	const char *sp = buf;
+	const char *const ep = buf + bsz;
+	struct frame_s f;
+
+	if (UNLIKELY(frmi == 1)) {
+		sp += FRAME_MAGIC_LEN;
+		frmi = 2;
+	}
+	for (const char *eo; (eo = frame_get(&f, sp, ep)) != NULL; sp = eo) {
+		stmt1(f.s, f.z, f.dirp);
+	}
+	if (UNLIKELY(lastp && sp < ep)) {
+		errno = 0, error("Warning: input ends inside a frame");
+	}
+	return sp - buf;
+}
+
+static int
+expand1(const char *fn)
+{
+	static char _buf[65536U];
+	char *buf = _buf;
+	size_t bsz = sizeof(_buf);
+	size_t bix;
+	int rc = 0;
+	int fd;
+
+	if (fn == NULL) {
+		fd = STDIN_FILENO;
+	} else if ((fd = open(fn, O_RDONLY)) < 0) {
+		error("Error: cannot open file `%s'", fn);
+		return -1;
+	}
+	/* read into buf */
+	bix = 0U;
+	frmi = -1;
+	nbad = 0U;
+	memset(&scn, 0, sizeof(scn));
+	for (ssize_t nrd, npr;
+	     (nrd = read(fd, buf + bix, bsz - bix - 1U/*\nul*/)) > 0;) {
+		/* mark the end of the buffer */
+		buf[bix += nrd] = '\0';
+		if (UNLIKELY(frmi < 0) && (frmi = frame_magicp(buf, bix)) < 0) {
+			/* can't tell yet whether it's framed */
+			continue;
+		}
+		if ((npr = (frmi ? proc_frm : proc)(buf, bix, false)) < 0) {
+			rc = -1;
+			goto fuck;
+		} else if (npr == 0 && bix + 1 >= bsz) {
+			/* need a bigger buffer */
+			RESZ(buf, bsz, bsz << 1U)
+			else {
+				rc = -1;
+				goto fuck;
+			}
+		} else if (npr == 0) {
+			/* just read some more */
+			;
+		} else if ((bix -= npr) > 0) {
+			/* memmove to the front */
+			memmove(buf, buf + npr, bix);
+		}
+	}
+	/* finalise buffer again, just in case */
+	buf[bix] = '\0';
+	/* last try, we don't care how much gets processed */
+	(void)(frmi > 0 ? proc_frm : proc)(buf, bix, true);
+
+fuck:
+	if (jobs != NULL) {
+		jobs_drain();
+	}
+	obuf_write(sob, xp.o.b, xp.o.n);
+	xp.o.n = 0U;
+	/* prefixes and base don't carry over to the next file */
+	clr_prefixes();
+	if (nbad) {
+		errno = 0, error("\
+Warning: %zu statements in `%s' could not be expanded",
+				 nbad, fn ?: "-");
+		rc = -1;
+	}
+	close(fd);
+	if (buf != _buf) {
+		munmap(buf, bsz);
+	}
+	return rc;
+}
+
+
+#include "ttl2nt.yucc"
+
+int
+main(int argc, char *argv[])
+{
+	yuck_t argi[1U];
+	int rc = 0;
+
+	if (yuck_parse(argi, argc, argv) < 0) {
+		rc = 1;
+		goto out;
+	}
+
+	if (UNLIKELY((sob = make_obuf(STDOUT_FILENO, 0U, OBUF_ASYNC)) == NULL)) {
+		error("Error: cannot set up output buffer");
+		rc = 1;
+		goto out;
+	}
+	if (argi->jobs_arg &&
+	    init_jobs(strtoul(argi->jobs_arg, NULL, 0)) < 0) {
+		error("Error: cannot start worker threads");
+		rc = 1;
+		goto out;
+	}
+
+	if (!argi->nargs) {
+		rc = expand1(NULL) < 0;
+	}
+	for (size_t i = 0U; i < argi->nargs; i++) {
+		rc |= expand1(argi->args[i]) < 0;
+	}
+
+	/* resource freeing */
+	fini_jobs();
+	rc |= free_obuf(sob) < 0;
+	free(xp.o.b);
+	free(xp.t.b);
+	free(pres);
+	free(pht);
+
+out:
+	yuck_free(argi);
+	return rc;
+}
+
+/* ttl2nt.c ends here */
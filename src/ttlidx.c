@@ -0,0 +1,414 @@
+/*** ttlidx.c -- statement offset index sidecars
+ *
+ * Copyright (C) 2026 Sebastian Freundt
+ *
+ * Author:  Sebastian Freundt <freundt@ga-group.nl>
+ *
+ * This file is part of rdfsnips.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the author nor the names of any contributors
+ *    may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED.  IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ ***/
+#if defined HAVE_CONFIG_H
+# include "config.h"
+#endif	/* HAVE_CONFIG_H */
+#include <stdlib.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "ttlidx.h"
+#include "nifty.h"
+
+struct ttlidx_s {
+	size_t strd;
+	size_t nent;
+	/* statements seen so far (writer) */
+	size_t nstmt;
+	/* last entry, for the deltas */
+	size_t loff;
+	size_t ldirz;
+
+	struct ttlidx_anc_s *anc;
+	size_t nanc;
+	size_t zanc;
+
+	char *dir;
+	size_t dirz;
+	size_t zdir;
+
+	uint8_t *dat;
+	size_t datz;
+	size_t zdat;
+
+	/* reader, the mapped file and the size of the indexed file */
+	void *map;
+	size_t mapz;
+	size_t srcz;
+};
+
+
+static void*
+grow(void *p, size_t *z, size_t need, size_t elz)
+{
+	size_t nuz = *z ?: 64U;
+
+	if (need <= *z) {
+		return p;
+	}
+	while (nuz < need) {
+		nuz <<= 1U;
+	}
+	if (UNLIKELY((p = realloc(p, nuz * elz)) == NULL)) {
+		return NULL;
+	}
+	*z = nuz;
+	return p;
+}
+
+static size_t
+put_leb(uint8_t *restrict tgt, uint64_t x)
+{
+	size_t i = 0U;
+
+	for (; x >= 0x80U; x >>= 7U) {
+		tgt[i++] = (uint8_t)(x | 0x80U);
+	}
+	tgt[i++] = (uint8_t)x;
+	return i;
+}
+
+static size_t
+get_leb(uint64_t *restrict x, const uint8_t *src, const uint8_t *end)
+{
+/* return the number of bytes consumed or 0 if SRC runs past END */
+	uint64_t r = 0U;
+	size_t i = 0U;
+
+	for (unsigned int sh = 0U;; sh += 7U) {
+		if (UNLIKELY(src + i >= end || sh >= 64U)) {
+			return 0U;
+		}
+		r |= (uint64_t)(src[i] & 0x7fU) << sh;
+		if (!(src[i++] & 0x80U)) {
+			break;
+		}
+	}
+	*x = r;
+	return i;
+}
+
+static inline uint64_t
+mtime_ns(const struct stat *st)
+{
+	return (uint64_t)st->st_mtim.tv_sec * 1000000000ULL +
+		(uint64_t)st->st_mtim.tv_nsec;
+}
+
+static size_t
+wr_all(int fd, const void *buf, size_t bsz)
+{
+	size_t tot = 0U;
+
+	for (ssize_t nwr;
+	     tot < bsz &&
+		     (nwr = write(fd, (const char*)buf + tot, bsz - tot)) > 0;
+	     tot += nwr);
+	return tot;
+}
+
+
+ttlidx_t
+make_ttlidx(size_t strd)
+{
+	struct ttlidx_s *r;
+
+	if (UNLIKELY((r = calloc(1, sizeof(*r))) == NULL)) {
+		return NULL;
+	}
+	r->strd = strd ?: 1U;
+	return r;
+}
+
+void
+free_ttlidx(ttlidx_t x)
+{
+	if (x->map != NULL) {
+		munmap(x->map, x->mapz);
+	} else {
+		free(x->anc);
+		free(x->dir);
+		free(x->dat);
+	}
+	free(x);
+	return;
+}
+
+int
+ttlidx_add_dir(ttlidx_t x, const char *s, size_t z)
+{
+	char *nud;
+
+	if (UNLIKELY((nud = grow(x->dir, &x->zdir, x->dirz + z + 1U, 1U)) == NULL)) {
+		return -1;
+	}
+	x->dir = nud;
+	memcpy(x->dir + x->dirz, s, z);
+	x->dirz += z;
+	x->dir[x->dirz++] = '\n';
+	return 0;
+}
+
+int
+ttlidx_add_stmt(ttlidx_t x, size_t off)
+{
+	if (x->nstmt++ % x->strd) {
+		return 0;
+	}
+	if (!(x->nent % TTLIDX_ANCS)) {
+		struct ttlidx_anc_s *nua;
+
+		nua = grow(x->anc, &x->zanc, x->nanc + 1U, sizeof(*x->anc));
+		if (UNLIKELY(nua == NULL)) {
+			return -1;
+		}
+		x->anc = nua;
+		x->anc[x->nanc++] = (struct ttlidx_anc_s){
+			off, x->dirz, x->datz,
+		};
+	} else {
+		uint8_t *nud;
+
+		/* two LEB128s of 64 bits at most */
+		nud = grow(x->dat, &x->zdat, x->datz + 20U, 1U);
+		if (UNLIKELY(nud == NULL)) {
+			return -1;
+		}
+		x->dat = nud;
+		x->datz += put_leb(x->dat + x->datz, off - x->loff);
+		x->datz += put_leb(x->dat + x->datz, x->dirz - x->ldirz);
+	}
+	x->loff = off;
+	x->ldirz = x->dirz;
+	x->nent++;
+	return 0;
+}
+
+int
+ttlidx_write(ttlidx_t x, const char *fn, const struct stat *src)
+{
+	const struct ttlidx_hdr_s hdr = {
+		TTLIDX_MAGIC,
+		x->strd, x->nent, x->nanc, x->dirz, x->datz,
+		src->st_size, mtime_ns(src),
+	};
+	const size_t az = x->nanc * sizeof(*x->anc);
+	int fd;
+	int rc = 0;
+
+	if (UNLIKELY((fd = open(fn, O_CREAT | O_TRUNC | O_WRONLY, 0666)) < 0)) {
+		return -1;
+	}
+	rc -= wr_all(fd, &hdr, sizeof(hdr)) < sizeof(hdr);
+	rc -= wr_all(fd, x->anc, az) < az;
+	rc -= wr_all(fd, x->dir, x->dirz) < x->dirz;
+	rc -= wr_all(fd, x->dat, x->datz) < x->datz;
+	close(fd);
+	return rc;
+}
+
+static bool
+ancs_ok_p(const struct ttlidx_hdr_s *hdr)
+{
+/* check that every anchor points into the delta stream and the file */
+	const struct ttlidx_anc_s *a = (const void*)(hdr + 1U);
+
+	for (size_t i = 0U; i < hdr->nanc; i++) {
+		/* number of deltas following this anchor */
+		const size_t nd = i + 1U < hdr->nanc
+			? TTLIDX_ANCS - 1U
+			: (hdr->nent - 1U) % TTLIDX_ANCS;
+
+		if (a[i].off > hdr->srcz || a[i].dirz > hdr->dirz) {
+			return false;
+		} else if (nd ? a[i].pos >= hdr->datz : a[i].pos > hdr->datz) {
+			return false;
+		} else if (i && a[i].off < a[i - 1U].off) {
+			return false;
+		}
+	}
+	return true;
+}
+
+ttlidx_t
+ttlidx_open(const char *fn, const struct stat *src)
+{
+	const struct ttlidx_hdr_s *hdr;
+	struct ttlidx_s *r;
+	struct stat st;
+	void *map;
+	int fd;
+
+	if ((fd = open(fn, O_RDONLY)) < 0) {
+		return NULL;
+	} else if (fstat(fd, &st) < 0 ||
+		   (size_t)st.st_size < sizeof(*hdr)) {
+		close(fd);
+		return NULL;
+	}
+	map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (UNLIKELY(map == MAP_FAILED)) {
+		return NULL;
+	}
+	hdr = map;
+	if (memcmp(hdr->magic, TTLIDX_MAGIC, sizeof(hdr->magic))) {
+		errno = EINVAL;
+		goto nope;
+	} else if (hdr->srcz != (uint64_t)src->st_size ||
+		   hdr->srcmt != mtime_ns(src)) {
+		/* index is for a different version of the file */
+		errno = ESTALE;
+		goto nope;
+	} else if (hdr->nanc != (hdr->nent + TTLIDX_ANCS - 1U) / TTLIDX_ANCS ||
+		   hdr->nanc > (size_t)st.st_size / sizeof(*r->anc) ||
+		   hdr->dirz > (size_t)st.st_size ||
+		   hdr->datz > (size_t)st.st_size ||
+		   sizeof(*hdr) + hdr->nanc * sizeof(*r->anc) +
+		   hdr->dirz + hdr->datz > (size_t)st.st_size ||
+		   !ancs_ok_p(hdr)) {
+		errno = EINVAL;
+		goto nope;
+	} else if (UNLIKELY((r = calloc(1, sizeof(*r))) == NULL)) {
+		goto nope;
+	}
+	r->map = map;
+	r->mapz = st.st_size;
+	r->srcz = hdr->srcz;
+	r->strd = hdr->strd;
+	r->nent = hdr->nent;
+	r->nanc = hdr->nanc;
+	r->dirz = hdr->dirz;
+	r->datz = hdr->datz;
+	r->anc = (void*)((char*)map + sizeof(*hdr));
+	r->dir = (char*)(r->anc + r->nanc);
+	r->dat = (uint8_t*)(r->dir + r->dirz);
+	return r;
+nope:
+	munmap(map, st.st_size);
+	return NULL;
+}
+
+size_t
+ttlidx_nent(ttlidx_t x)
+{
+	return x->nent;
+}
+
+size_t
+ttlidx_strd(ttlidx_t x)
+{
+	return x->strd;
+}
+
+int
+ttlidx_get(ttlidx_t x, size_t k, size_t *off, size_t *dirz)
+{
+	const struct ttlidx_anc_s *a;
+	const uint8_t *dp;
+	uint64_t o, d;
+
+	if (UNLIKELY(k >= x->nent)) {
+		return -1;
+	}
+	a = x->anc + k / TTLIDX_ANCS;
+	o = a->off;
+	d = a->dirz;
+	dp = x->dat + a->pos;
+	for (size_t i = k % TTLIDX_ANCS; i > 0U; i--) {
+		const uint8_t *const ep = x->dat + x->datz;
+		uint64_t v, w;
+		size_t nv, nw;
+
+		if (UNLIKELY(!(nv = get_leb(&v, dp, ep)) ||
+			     !(nw = get_leb(&w, dp + nv, ep)))) {
+			return -1;
+		}
+		dp += nv + nw;
+		o += v;
+		d += w;
+	}
+	if (x->map != NULL && UNLIKELY(o > x->srcz || d > x->dirz)) {
+		/* corrupt, don't let anyone read out of bounds */
+		return -1;
+	}
+	if (off != NULL) {
+		*off = o;
+	}
+	if (dirz != NULL) {
+		*dirz = d;
+	}
+	return 0;
+}
+
+size_t
+ttlidx_find(ttlidx_t x, size_t off, size_t *dirz)
+{
+	size_t lo = 0U, hi = x->nent;
+	size_t o = 0U;
+
+	while (lo < hi) {
+		size_t mid = (lo + hi) / 2U;
+
+		if (UNLIKELY(ttlidx_get(x, mid, &o, NULL) < 0)) {
+			return (size_t)-1;
+		} else if (o < off) {
+			lo = mid + 1U;
+		} else {
+			hi = mid;
+		}
+	}
+	if (ttlidx_get(x, lo, &o, dirz) < 0) {
+		return (size_t)-1;
+	}
+	return o;
+}
+
+const char*
+ttlidx_dirs(ttlidx_t x, size_t *dirz)
+{
+	if (dirz != NULL) {
+		*dirz = x->dirz;
+	}
+	return x->dir;
+}
+
+/* ttlidx.c ends here */
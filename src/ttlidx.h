@@ -0,0 +1,134 @@
+/*** ttlidx.h -- statement offset index sidecars
+ *
+ * Copyright (C) 2026 Sebastian Freundt
+ *
+ * Author:  Sebastian Freundt <freundt@ga-group.nl>
+ *
+ * This file is part of rdfsnips.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the author nor the names of any contributors
+ *    may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED.  IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ ***/
+#if !defined INCLUDED_ttlidx_h_
+#define INCLUDED_ttlidx_h_
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/stat.h>
+
+/* An index (conventionally FILE.ttlidx) records the byte offset of
+ * every STRIDE-th statement of FILE along with the directives in
+ * effect at that point, so tools can seek into FILE and start
+ * scanning right away.
+ *
+ * The on-disk layout, all integers in host byte order, is:
+ *   struct ttlidx_hdr_s
+ *   struct ttlidx_anc_s[nanc]   absolute values for every 64th entry
+ *   char[dirz]                  all directives, each \n-terminated
+ *   uint8_t[datz]               LEB128 deltas (offset, dirlen) for the
+ *                               remaining entries following each anchor
+ * which makes the file directly usable when mmap()ed.
+ *
+ * The size and modification time of FILE are recorded too, an index
+ * that doesn't match its FILE any longer is refused upon opening. */
+
+#define TTLIDX_MAGIC	"ttlidx2\n"
+#define TTLIDX_ANCS	(64U)
+
+struct ttlidx_hdr_s {
+	char magic[8U];
+	uint64_t strd;
+	uint64_t nent;
+	uint64_t nanc;
+	uint64_t dirz;
+	uint64_t datz;
+	/* size and mtime (in ns) of the indexed file */
+	uint64_t srcz;
+	uint64_t srcmt;
+};
+
+struct ttlidx_anc_s {
+	/* byte offset of the statement boundary */
+	uint64_t off;
+	/* length of the directive block in effect */
+	uint64_t dirz;
+	/* position of the next entry in the delta stream */
+	uint64_t pos;
+};
+
+typedef struct ttlidx_s *ttlidx_t;
+
+/**
+ * Start a new index that records every STRD-th statement. */
+extern ttlidx_t make_ttlidx(size_t strd);
+
+/**
+ * Free resources associated with an index, opened or made. */
+extern void free_ttlidx(ttlidx_t);
+
+/**
+ * Record directive S of length Z. */
+extern int ttlidx_add_dir(ttlidx_t, const char *s, size_t z);
+
+/**
+ * Record that a statement starts at byte offset OFF. */
+extern int ttlidx_add_stmt(ttlidx_t, size_t off);
+
+/**
+ * Write index to file FN, SRC being the stat of the indexed file. */
+extern int ttlidx_write(ttlidx_t, const char *fn, const struct stat *src);
+
+/**
+ * Map the index in file FN for reading, SRC being the stat of the
+ * indexed file.  Return NULL and set errno to ESTALE if the index
+ * doesn't belong to SRC (any longer), or to EINVAL if it's corrupt. */
+extern ttlidx_t ttlidx_open(const char *fn, const struct stat *src);
+
+/**
+ * Return the number of entries in an index. */
+extern size_t ttlidx_nent(ttlidx_t);
+
+/**
+ * Return the statement stride of an index. */
+extern size_t ttlidx_strd(ttlidx_t);
+
+/**
+ * Obtain offset and the length of the directive block for entry K.
+ * Return 0 on success or -1 if K is out of range. */
+extern int ttlidx_get(ttlidx_t, size_t k, size_t *off, size_t *dirz);
+
+/**
+ * Find the first entry at or beyond byte offset OFF, return its offset
+ * and, if non-NULL, the length of its directive block in *DIRZ.
+ * Return (size_t)-1 if there's no such entry. */
+extern size_t ttlidx_find(ttlidx_t, size_t off, size_t *dirz);
+
+/**
+ * Return the directive block and, if non-NULL, its length in *DIRZ. */
+extern const char *ttlidx_dirs(ttlidx_t, size_t *dirz);
+
+#endif	/* INCLUDED_ttlidx_h_ */
@@ -44,6 +44,7 @@
 #include <string.h>
 #include <stdarg.h>
 #include <errno.h>
+#include "obuf.h"
 #include "nifty.h"
 
 
@@ -118,6 +119,9 @@ kilpc(char *restrict s, size_t z)
 	return k;
 }
 
+/* buffered stdout */
+static obuf_t sob;
+
 static int
 fold1(FILE *fp)
 {
@@ -131,7 +135,7 @@ fold1(FILE *fp)
 			nrd = kilpc(line, nrd);
 		} while (rcur && haspc(line, nrd));
 		line[nrd++] = '\n';
-		fwrite(line, 1, nrd, stdout);
+		obuf_write(sob, line, nrd);
 	}
 	return 0;
 }
@@ -153,6 +157,11 @@ main(int argc, char *argv[])
 		f1st = '2';
 	}
 	rcur = (uint_fast8_t)argi->recursive_flag;
+	if (UNLIKELY((sob = make_obuf(STDOUT_FILENO, 0U, 0U)) == NULL)) {
+		error("Error: cannot set up output buffer");
+		rc = 1;
+		goto out;
+	}
 
 	if (!argi->nargs) {
 		rc = fold1(stdin) < 0;
@@ -168,6 +177,7 @@ Error: cannot open file `%s'", argi->args[i]);
 		rc |= fold1(fp) < 0;
 		fclose(fp);
 	}
+	rc |= free_obuf(sob) < 0;
 
 out:
 	yuck_free(argi);
@@ -0,0 +1,224 @@
+/*** obuf-api.c -- check buffered output to files and pipes
+ *
+ * Copyright (C) 2026 Sebastian Freundt
+ *
+ * Author:  Sebastian Freundt <freundt@ga-group.nl>
+ *
+ * This file is part of rdfsnips.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the author nor the names of any contributors
+ *    may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED.  IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ ***/
+#if defined HAVE_CONFIG_H
+# include "config.h"
+#endif	/* HAVE_CONFIG_H */
+#if defined HAVE_VMSPLICE
+/* for tee() */
+# define _GNU_SOURCE
+#endif	/* HAVE_VMSPLICE */
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/wait.h>
+#include "obuf.h"
+
+/* write a known stream through an obuf, in pieces smaller than, as
+ * large as and larger than the buffer, to a file and to a pipe, and
+ * check that what comes out is the stream */
+
+#define BSZ	(65536U)
+
+static char ref[16U * BSZ];
+
+static const size_t pcs[] = {
+	1U, 7U, 4095U, BSZ - 1U, BSZ, 3U, BSZ + 1U, 2U * BSZ, 100U, 3U * BSZ,
+};
+
+static int
+gen(int fd, unsigned int flags)
+{
+	obuf_t o;
+	size_t i = 0U;
+	int rc = 0;
+
+	if ((o = make_obuf(fd, BSZ, flags)) == NULL) {
+		return -1;
+	}
+	for (size_t k = 0U; i < sizeof(ref); k++) {
+		size_t z = pcs[k % (sizeof(pcs) / sizeof(*pcs))];
+
+		if (z > sizeof(ref) - i) {
+			z = sizeof(ref) - i;
+		}
+		if (k % 3U == 2U) {
+			/* split into two segments */
+			rc |= obuf_writev(o, (struct iovec[]){
+					{ref + i, z / 2U},
+					{ref + i + z / 2U, z - z / 2U}}, 2);
+		} else {
+			rc |= obuf_write(o, ref + i, z);
+		}
+		i += z;
+	}
+	rc |= free_obuf(o);
+	return rc;
+}
+
+static int
+chk(const char *what, int fd)
+{
+	static char buf[sizeof(ref) + 1U];
+	size_t n = 0U;
+
+	for (ssize_t nrd;
+	     (nrd = read(fd, buf + n, sizeof(buf) - n)) > 0; n += nrd);
+	if (n != sizeof(ref) || memcmp(buf, ref, n)) {
+		fprintf(stderr, "%s: output differs\n", what);
+		return -1;
+	}
+	return 0;
+}
+
+static int
+to_file(unsigned int flags)
+{
+	FILE *fp;
+	int rc;
+
+	if ((fp = tmpfile()) == NULL) {
+		perror("tmpfile");
+		return -1;
+	}
+	rc = gen(fileno(fp), flags);
+	lseek(fileno(fp), 0, SEEK_SET);
+	rc |= chk("file", fileno(fp));
+	fclose(fp);
+	return rc;
+}
+
+static int
+to_pipe(unsigned int flags)
+{
+	int p[2U];
+	pid_t pid;
+	int st;
+	int rc;
+
+	if (pipe(p) < 0) {
+		perror("pipe");
+		return -1;
+	}
+	switch ((pid = fork())) {
+	case -1:
+		perror("fork");
+		return -1;
+	case 0:
+		close(p[0U]);
+		_exit(gen(p[1U], flags) < 0);
+	default:
+		break;
+	}
+	close(p[1U]);
+	rc = chk("pipe", p[0U]);
+	close(p[0U]);
+	if (waitpid(pid, &st, 0) < 0 || !WIFEXITED(st) || WEXITSTATUS(st)) {
+		fputs("pipe: writer failed\n", stderr);
+		rc = -1;
+	}
+	return rc;
+}
+
+static int
+teed(void)
+{
+/* the reader tee(2)s what's in the pipe to another pipe, the pages
+ * referenced there must not change when the writer goes on */
+#if defined HAVE_VMSPLICE
+	static char buf[BSZ];
+	int p[2U], q[2U];
+	obuf_t o;
+	size_t n;
+	int rc = 0;
+
+	if (pipe(p) < 0 || pipe(q) < 0) {
+		perror("pipe");
+		return -1;
+	}
+	/* make sure both take a full buffer */
+	(void)fcntl(p[1U], F_SETPIPE_SZ, (int)BSZ);
+	(void)fcntl(q[1U], F_SETPIPE_SZ, (int)BSZ);
+	if ((o = make_obuf(p[1U], BSZ, 0U)) == NULL) {
+		return -1;
+	}
+	/* first buffer goes out, keep a copy of it in Q */
+	obuf_write(o, ref, BSZ);
+	if (tee(p[0U], q[1U], BSZ, 0) != BSZ) {
+		perror("tee");
+		rc = -1;
+	}
+	close(q[1U]);
+	/* drain P and refill both buffers */
+	for (size_t i = 1U; i < 4U; i++) {
+		for (n = 0U; n < BSZ; n += read(p[0U], buf + n, BSZ - n));
+		obuf_write(o, ref + i * BSZ, BSZ);
+	}
+	free_obuf(o);
+	close(p[0U]);
+	close(p[1U]);
+	n = 0U;
+	for (ssize_t nrd; (nrd = read(q[0U], buf + n, BSZ - n)) > 0; n += nrd);
+	if (n != BSZ || memcmp(buf, ref, BSZ)) {
+		fputs("tee: spliced pages have been overwritten\n", stderr);
+		rc = -1;
+	}
+	close(q[0U]);
+	return rc;
+#else  /* !HAVE_VMSPLICE */
+	return 0;
+#endif	/* HAVE_VMSPLICE */
+}
+
+int
+main(void)
+{
+	int rc = 0;
+
+	for (size_t i = 0U; i < sizeof(ref); i++) {
+		ref[i] = (char)(i * 131U + i / 4093U);
+	}
+	for (unsigned int f = 0U; f <= OBUF_ASYNC; f++) {
+		rc |= to_file(f);
+		rc |= to_pipe(f);
+	}
+	rc |= teed();
+	return -rc;
+}
+
+/* obuf-api.c ends here */
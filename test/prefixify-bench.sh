@@ -0,0 +1,46 @@
+#!/bin/sh
+## Time ttl-prefixify against growing numbers of prefixes.
+##
+## usage: prefixify-bench.sh [TTL-PREFIXIFY [NSTMT]]
+##
+## For 10 up to 100000 prefixes a file is generated that declares them,
+## half of them with a nested namespace that must win as the longer
+## match, followed by NSTMT statements (default 200000) whose IRIs are
+## drawn from those namespaces and from unknown ones.
+
+PREFIXIFY="${1:-../src/ttl-prefixify}"
+NSTMT="${2:-200000}"
+TMP=`mktemp -d "${TMPDIR:-/tmp}/pfxbench.XXXXXXXX"` || exit 1
+trap 'rm -rf "${TMP}"' EXIT
+
+for npfx in 10 100 1000 10000 100000; do
+	awk -v npfx="${npfx}" -v nstmt="${NSTMT}" '
+	function ns(i) {
+		return sprintf("http://%x.example.org/onto/", (i * 2654435761) % 4294967296)
+	}
+	BEGIN {
+		srand(1)
+		for (i = 0; i < npfx; i += 2) {
+			printf "@prefix p%d: <%s> .\n", i, ns(i)
+			printf "@prefix p%d: <%ssub#> .\n", i + 1, ns(i)
+		}
+		for (i = 0; i < nstmt; i++) {
+			s = int(rand() * npfx)
+			p = int(rand() * npfx)
+			o = int(rand() * 2 * npfx)
+			printf "<%s%s%d> <%sp%d> <%s%s%d> .\n", \
+				ns(s - s % 2), (s % 2) ? "sub#" : "", i, \
+				ns(p - p % 2), i % 7, \
+				o < npfx ? ns(o - o % 2) : "http://unknown.org/", \
+				(o % 2) ? "sub#" : "", i
+		}
+	}' > "${TMP}/in.ttl"
+
+	beg=`date +%s.%N`
+	"${PREFIXIFY}" "${TMP}/in.ttl" > "${TMP}/out.ttl" || exit 1
+	end=`date +%s.%N`
+
+	printf "%6d prefixes  %8.3fs  %10d -> %10d bytes\n" "${npfx}" \
+		`awk "BEGIN{print ${end} - ${beg}}"` \
+		`wc -c < "${TMP}/in.ttl"` `wc -c < "${TMP}/out.ttl"`
+done
@@ -0,0 +1,131 @@
+/*** scan-api.c -- check the embeddable scanner against chunked input
+ *
+ * Copyright (C) 2026 Sebastian Freundt
+ *
+ * Author:  Sebastian Freundt <freundt@ga-group.nl>
+ *
+ * This file is part of rdfsnips.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the author nor the names of any contributors
+ *    may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED.  IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ ***/
+#if defined HAVE_CONFIG_H
+# include "config.h"
+#endif	/* HAVE_CONFIG_H */
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "ttl-scan.h"
+
+/* feed a file in one go, then in chunks of every size up to its
+ * length, and check that we're always told the same statements */
+
+struct res_s {
+	char *buf;
+	size_t len;
+};
+
+static int
+prnt(const struct ttl_stmt_s *st, void *clo)
+{
+	struct res_s *r = clo;
+	char ln[256U];
+	size_t z;
+
+	z = snprintf(ln, sizeof(ln), "%u %u %zu %zu %zu %zu %.*s\n",
+		     (unsigned int)st->kind, (unsigned int)st->dirp,
+		     st->beg, st->end, st->npred, st->nobj,
+		     (int)(st->z < 32U ? st->z : 32U), st->s);
+	r->buf = realloc(r->buf, r->len + z + 1U);
+	memcpy(r->buf + r->len, ln, z + 1U);
+	r->len += z;
+	return 0;
+}
+
+static int
+scan1(struct res_s *r, const char *buf, size_t len, size_t chnk)
+{
+	ttl_scan_t c;
+	int rc = 0;
+
+	if ((c = make_ttl_scan(prnt, r)) == NULL) {
+		return -1;
+	}
+	for (size_t i = 0U; i < len; i += chnk) {
+		rc |= ttl_scan_feed(c, buf + i, i + chnk < len ? chnk : len - i);
+	}
+	if (ttl_scan_offset(c) != len) {
+		rc = -1;
+	}
+	rc |= ttl_scan_last(c);
+	free_ttl_scan(c);
+	return rc;
+}
+
+int
+main(int argc, char *argv[])
+{
+	const char *srcdir = getenv("srcdir") ?: ".";
+	char fn[4096U];
+	static char buf[65536U];
+	struct res_s ref = {NULL};
+	size_t len;
+	FILE *fp;
+	int rc = 0;
+
+	snprintf(fn, sizeof(fn), "%s/%s", srcdir,
+		 argc > 1 ? argv[1] : "lexical.ttl");
+	if ((fp = fopen(fn, "r")) == NULL) {
+		perror(fn);
+		return 1;
+	}
+	len = fread(buf, 1, sizeof(buf), fp);
+	fclose(fp);
+
+	if (scan1(&ref, buf, len, len) < 0) {
+		fputs("scanning in one go failed\n", stderr);
+		return 1;
+	}
+	fputs(ref.buf, stdout);
+	for (size_t chnk = 1U; chnk < len; chnk++) {
+		struct res_s r = {NULL};
+
+		if (scan1(&r, buf, len, chnk) < 0) {
+			fprintf(stderr, "scanning in chunks of %zu failed\n", chnk);
+			rc = 1;
+		} else if (r.len != ref.len || memcmp(r.buf, ref.buf, r.len)) {
+			fprintf(stderr, "chunks of %zu differ\n", chnk);
+			rc = 1;
+		}
+		free(r.buf);
+	}
+	free(ref.buf);
+	return rc;
+}
+
+/* scan-api.c ends here */